@@ -1,8 +1,11 @@
 #ifndef APPENDBUFFER_H
 #define APPENDBUFFER_H
 #include <Arduino.h>
+#include "perfProfiler.h"
 
 // need this (at least onesp32) since arduino loop and webserver might run on different cores/threads
+// same as in logBuffer.h, whichever is included first defines it
+#ifndef MUTEX_LOCK
 #if defined(ESP32)
 #define MUTEX_LOCK portENTER_CRITICAL(&logBuffer_mutex);
 #define MUTEX_UNLOCK portEXIT_CRITICAL(&logBuffer_mutex);
@@ -11,14 +14,57 @@ static portMUX_TYPE logBuffer_mutex = portMUX_INITIALIZER_UNLOCKED;
 #define MUTEX_LOCK noInterrupts(); // we must not implement waiting for a mutex here since in ISR wie can't wait!
 #define MUTEX_UNLOCK interrupts(); // we can only disable interrupts for the critical section of updating the buffer
 #endif
+#endif
+#define APPENDBUFFER_LOCK MUTEX_LOCK PERF_LOCK_BEGIN
+#define APPENDBUFFER_UNLOCK PERF_LOCK_END(PERF_APPENDBUFFER_LOCK) MUTEX_UNLOCK
+
+#define UINT32_DIGITS 10 // maximum number of decimal digits of uint32_t
+
+/**
+ * Non-owning slice of the content of an AppendBuffer, cheap to pass by value.
+ * Valid only as long as the content of the buffer is not reset or the buffer destroyed.
+ * Note: a slice is not '\0'-terminated.
+ */
+class AppendBufferView
+{
+public:
+    AppendBufferView(const char *data, const size_t length) : _data(data), _length(length) {}
+
+    const char *data() const { return _data; }
+    size_t length() const { return _length; }
+
+    /** @return part of this view, limited to its length */
+    AppendBufferView slice(size_t from, size_t length) const
+    {
+        if (from > _length)
+            from = _length;
+        if (length > (_length - from))
+            length = _length - from;
+        return AppendBufferView(&_data[from], length);
+    }
+
+    size_t printTo(Print &out) const
+    {
+        return out.write((const uint8_t *)_data, _length);
+    }
+
+private:
+    const char *_data;
+    size_t _length;
+};
 
 /**
  * Buffer with limited length.
  * Overflowing characters are truncated.
+ * 
+ * Can not be copied, pass it by reference or pass a view().
+ * For memory on stack or statically allocated use StaticAppendBuffer.
  */
 class AppendBuffer : public Print
 {
 public:
+    using Print::write;
+
     /* Usage: <code>buf->sprintf_P(PSTR("abc"), ...);</code> */
     void printf_P(const char *pstrFormat...)
     {
@@ -31,7 +77,7 @@ public:
     {
         const int remains = getCapacityLeft();
         const int written = vsnprintf_P(_appendPos, remains, pstrFormat, args);
-        _appendPos += (written < remains) ? written : remains;
+        _appendPos += (written < remains) ? written : remains - 1; // if truncated, vsnprintf() kept the last character for '\0'
     }
     /** Convenience function - shortcut for: <code>abuf.reset(); abuf.printf_P(); return abuf.c_str();</code> */
     const char *format(const char *pstrFormat...)
@@ -51,7 +97,7 @@ public:
     }
     size_t write(const char *str)
     {
-        MUTEX_LOCK;
+        APPENDBUFFER_LOCK;
         size_t maxLength = getCapacityLeft();
         size_t written = 0;
         while (('\0' != *str) && (maxLength > 1))
@@ -61,14 +107,14 @@ public:
             ++written;
         }
         *_appendPos = '\0';
-        MUTEX_UNLOCK;
+        APPENDBUFFER_UNLOCK;
         return written;
     }
 
     /** Append string from flash/program memory to this buffer */
     void append_P(const __FlashStringHelper *pgmstr)
     {
-        MUTEX_LOCK;
+        APPENDBUFFER_LOCK;
         // _appendPos = appendstr_P(_appendPos, pgmstr, _maxsize - _appendPos + _buf);
         const char *pstr = (char *)pgmstr;
         size_t maxLength = getCapacityLeft();
@@ -79,33 +125,133 @@ public:
             --maxLength;
         }
         *_appendPos = '\0';
-        MUTEX_UNLOCK;
+        APPENDBUFFER_UNLOCK;
+    }
+
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        APPENDBUFFER_LOCK;
+        size_t maxLength = getCapacityLeft();
+        size_t written = 0;
+        while ((written < size) && (maxLength > 1))
+        {
+            *_appendPos++ = buffer[written++];
+            --maxLength;
+        }
+        *_appendPos = '\0';
+        APPENDBUFFER_UNLOCK;
+        return written;
     }
 
     virtual size_t write(uint8_t c)
     {
-        MUTEX_LOCK;
+        APPENDBUFFER_LOCK;
         if (getCapacityLeft() > 1)
         {
             *_appendPos++ = c;
             *_appendPos = '\0';
-            MUTEX_UNLOCK;
+            APPENDBUFFER_UNLOCK;
             return 1;
         }
         else
         {
-            MUTEX_UNLOCK;
+            APPENDBUFFER_UNLOCK;
             return 0;
         }
     }
 
+    /** Append value as decimal number, formatted without printf */
+    size_t appendUInt(const uint32_t value)
+    {
+        char digits[UINT32_DIGITS];
+        const uint8_t len = formatDigits(digits, value);
+        return write((const uint8_t *)&digits[UINT32_DIGITS - len], len);
+    }
+    size_t appendInt(const int32_t value)
+    {
+        if (value < 0)
+            return write('-') + appendUInt(0u - (uint32_t)value);
+        return appendUInt(value);
+    }
+    /** Append value as decimal number with leading pad characters up to width, e.g. <code>appendPadded(7, 2)</code> gives "07" */
+    size_t appendPadded(const uint32_t value, uint8_t width, const char pad = '0')
+    {
+        char digits[UINT32_DIGITS];
+        const uint8_t len = formatDigits(digits, value);
+        size_t written = 0;
+        for (; width > len; --width)
+            written += write(pad);
+        return written + write((const uint8_t *)&digits[UINT32_DIGITS - len], len);
+    }
+    /** Append fixed-point number of value scaled by 10^decimals, e.g. <code>appendFixed(-2315, 2)</code> gives "-23.15" */
+    size_t appendFixed(const int32_t value, uint8_t decimals)
+    {
+        if (decimals > (UINT32_DIGITS - 1))
+            decimals = UINT32_DIGITS - 1;
+        const uint32_t absValue = (value < 0) ? (0u - (uint32_t)value) : value;
+        uint32_t scale = 1;
+        for (uint8_t i = 0; i < decimals; ++i)
+            scale *= 10;
+        size_t written = (value < 0) ? write('-') : 0;
+        written += appendUInt(absValue / scale);
+        if (decimals > 0)
+        {
+            written += write('.');
+            written += appendPadded(absValue % scale, decimals);
+        }
+        return written;
+    }
+    /** Append value as hexadecimal number (upper case, as Print does), with leading zeros up to minDigits */
+    size_t appendHex(uint32_t value, const uint8_t minDigits = 1)
+    {
+        char digits[8];
+        uint8_t len = 0;
+        do
+        {
+            digits[7 - len++] = "0123456789ABCDEF"[value & 0x0F];
+            value >>= 4;
+        } while (value);
+        while ((len < minDigits) && (len < sizeof(digits)))
+            digits[7 - len++] = '0';
+        return write((const uint8_t *)&digits[8 - len], len);
+    }
+
+    /**
+     * Writes value as decimal number into buf, with terminating '\0'.
+     * @return position of the terminator
+     */
+    static char *formatUInt(char *buf, const uint32_t value)
+    {
+        char digits[UINT32_DIGITS];
+        const uint8_t len = formatDigits(digits, value);
+        memcpy(buf, &digits[UINT32_DIGITS - len], len);
+        buf[len] = '\0';
+        return &buf[len];
+    }
+
+    /**
+     * Writes value as decimal number into buf, with terminating '\0', padded with leading pad characters up to width.
+     * Like formatUInt() it does not lock, so it can be used while another lock is held.
+     * @return position of the terminator
+     */
+    static char *formatPadded(char *buf, const uint32_t value, uint8_t width, const char pad = '0')
+    {
+        char digits[UINT32_DIGITS];
+        const uint8_t len = formatDigits(digits, value);
+        for (; width > len; --width)
+            *buf++ = pad;
+        memcpy(buf, &digits[UINT32_DIGITS - len], len);
+        buf[len] = '\0';
+        return &buf[len];
+    }
+
     /** Reset buffer to empty string */
     void reset()
     {
-        MUTEX_LOCK;
+        APPENDBUFFER_LOCK;
         _appendPos = _buf;
         *_buf = '\0';
-        MUTEX_UNLOCK;
+        APPENDBUFFER_UNLOCK;
     }
 
     char *c_str()
@@ -113,14 +259,20 @@ public:
         return _buf;
     }
 
+    /** @return view of the current content, without copying it */
+    AppendBufferView view()
+    {
+        return AppendBufferView(_buf, size());
+    }
+
     /**
      * @return number of bytes contained
      */
     size_t size()
     {
-        MUTEX_LOCK;
+        APPENDBUFFER_LOCK;
         const size_t result = (_appendPos - _buf);
-        MUTEX_UNLOCK;
+        APPENDBUFFER_UNLOCK;
         return result;
     }
 
@@ -128,27 +280,61 @@ public:
      * Create an instance with externally supplied memory for buffer.
      * This allows to use statically allocated memory to be recognized at linking time.
      */
-    AppendBuffer(const size_t size, char *buf) : _maxsize(size), _buf(buf)
+    AppendBuffer(const size_t size, char *buf) : _maxsize(size), _buf(buf), _owned(false)
     {
         _appendPos = _buf;
+        *_buf = '\0';
     }
 
     /**
      * Use this constructor at your own risk: the linker won't provide an error if not enough memory available!
      */
-    AppendBuffer(size_t size) : _maxsize(size), _buf(new char[_maxsize])
+    AppendBuffer(size_t size) : _maxsize(size), _buf(new char[_maxsize]), _owned(true)
     {
         _appendPos = _buf;
+        *_buf = '\0';
     }
+    AppendBuffer(const AppendBuffer &) = delete;
+    AppendBuffer &operator=(const AppendBuffer &) = delete;
     ~AppendBuffer()
     {
-        delete _buf;
+        if (_owned)
+            delete[] _buf;
     }
 
 private:
     size_t _maxsize; // number of characters, including the trailing '\0'
     char *_buf;
     char *_appendPos; // position in buffer where next character to place at
+    bool _owned;      // if _buf was allocated by this instance
+
+    /**
+     * Writes decimal digits of value right-aligned into digits, two digits per division.
+     * @return number of digits
+     */
+    static uint8_t formatDigits(char *digits, uint32_t value)
+    {
+        static const char DIGIT_PAIRS[] PROGMEM =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+        char *pos = &digits[UINT32_DIGITS];
+        while (value >= 100)
+        {
+            const uint8_t pair = (value % 100) * 2;
+            value /= 100;
+            *--pos = pgm_read_byte(&DIGIT_PAIRS[pair + 1]);
+            *--pos = pgm_read_byte(&DIGIT_PAIRS[pair]);
+        }
+        if (value >= 10)
+        {
+            *--pos = pgm_read_byte(&DIGIT_PAIRS[value * 2 + 1]);
+            *--pos = pgm_read_byte(&DIGIT_PAIRS[value * 2]);
+        }
+        else
+            *--pos = '0' + value;
+        return &digits[UINT32_DIGITS] - pos;
+    }
 
     /** 
      * Not synchronized!
@@ -156,4 +342,24 @@ private:
      */
     size_t getCapacityLeft() { return (_maxsize - (size_t)_appendPos + (size_t)_buf); }
 };
+
+/**
+ * AppendBuffer with memory inside the instance, for use on stack or as static variable:
+ * <code>StaticAppendBuffer<32> buf;</code>
+ * Can be moved (copies content), but not copied.
+ */
+template <size_t N>
+class StaticAppendBuffer : public AppendBuffer
+{
+public:
+    StaticAppendBuffer() : AppendBuffer(N, _storage) {}
+    StaticAppendBuffer(StaticAppendBuffer &&other) : AppendBuffer(N, _storage)
+    {
+        other.view().printTo(*this);
+        other.reset();
+    }
+
+private:
+    char _storage[N];
+};
 #endif
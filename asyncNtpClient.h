@@ -0,0 +1,286 @@
+/*
+AsyncNtpClient - NTP client not blocking while waiting for the server's reply.
+
+Copyright (C) 2020  Matthias Clauß
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ASYNC_NTP_CLIENT_H
+#define ASYNC_NTP_CLIENT_H
+
+#include <Arduino.h>
+#include <Udp.h>
+#if defined(ESP32)
+#include <WiFi.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#endif
+#if defined(ESP32) || defined(ESP8266)
+#include <lwip/dns.h>
+#endif
+#if defined(ESP32) && defined(CONFIG_LWIP_TCPIP_CORE_LOCKING) && CONFIG_LWIP_TCPIP_CORE_LOCKING
+#include <lwip/tcpip.h>
+#define ASYNC_NTP_LOCK_TCPIP 1 // lwIP must not be called concurrently to its own thread
+#else
+#define ASYNC_NTP_LOCK_TCPIP 0
+#endif
+
+#ifndef ASYNC_NTP_TIMEOUT
+#define ASYNC_NTP_TIMEOUT 2000 // in [ms], how long to wait for the reply of the NTP server, and for resolving its name
+#endif
+#ifndef ASYNC_NTP_RESOLVE_AFTER_FAILURES
+#define ASYNC_NTP_RESOLVE_AFTER_FAILURES 4 // number of consecutive requests without reply, after which the server name is resolved again
+#endif
+#define ASYNC_NTP_PACKET_SIZE 48
+#define ASYNC_NTP_PORT 123
+#define ASYNC_NTP_LOCAL_PORT 1337
+#define ASYNC_NTP_SEVENTY_YEARS 2208988800UL // NTP counts from 1900, unix epoch from 1970
+
+enum AsyncNtpState : byte
+{
+    NTP_IDLE = 0, // no request pending
+    NTP_PENDING,  // request sent, waiting for reply
+    NTP_SUCCESS,  // reply received, time updated
+    NTP_FAILED    // no reply within ASYNC_NTP_TIMEOUT
+};
+
+enum AsyncNtpResolveState : byte
+{
+    NTP_UNRESOLVED = 0, // server name is resolved with next request
+    NTP_RESOLVING,      // DNS query sent, waiting for its callback
+    NTP_RESOLVED,       // server address is known
+    NTP_UNRESOLVABLE    // DNS query failed, is repeated with next request
+};
+
+/**
+ * NTP client with separated request and reply handling, neither waits for the NTP server.
+ * Interface follows NTPClient (https://github.com/arduino-libraries/NTPClient) where possible.
+ * On ESP32/ESP8266 the server name is resolved asynchronously via lwIP, and the address is kept till ASYNC_NTP_RESOLVE_AFTER_FAILURES requests in a row got no reply.
+ * Since the DNS callback refers to it, the instance must not be destroyed, e.g. use a global variable.
+ * 
+ * Usage:<pre>
+ * client.sendRequest();
+ * // later, e.g. in each loop():
+ * if (NTP_SUCCESS == client.poll()) ...
+ * </pre>
+ */
+class AsyncNtpClient
+{
+private:
+    UDP &_udp;
+    const char *_serverName;
+    long _timeOffset;
+#if defined(ESP32) || defined(ESP8266)
+    volatile uint32_t _serverIP = 0; // both written by the DNS callback, in the context of lwIP
+    volatile AsyncNtpResolveState _resolveState = NTP_UNRESOLVED;
+    byte _failures = 0; // consecutive requests without reply
+    bool _packetSent = false;
+#endif
+    bool _udpSetup = false;
+    AsyncNtpState _state = NTP_IDLE;
+    unsigned long _requestMs = 0;
+    unsigned long _currentEpoch = 0; // in [s] since 1970, at _lastUpdateMs
+    unsigned long _lastUpdateMs = 0;
+    byte _packetBuffer[ASYNC_NTP_PACKET_SIZE];
+
+#if defined(ESP32) || defined(ESP8266)
+    static void dnsFound(const char *, const ip_addr_t *ipaddr, void *arg)
+    {
+        AsyncNtpClient *client = (AsyncNtpClient *)arg;
+        if (nullptr != ipaddr)
+            client->_serverIP = ip_addr_get_ip4_u32(ipaddr);
+        client->_resolveState = (nullptr != ipaddr) ? NTP_RESOLVED : NTP_UNRESOLVABLE;
+    }
+
+    /** Starts resolving the server name, if not yet in progress. @return false if the name can't be resolved */
+    bool resolve()
+    {
+        if (NTP_RESOLVING == _resolveState)
+            return true;
+        _resolveState = NTP_RESOLVING;
+        ip_addr_t addr;
+#if ASYNC_NTP_LOCK_TCPIP
+        LOCK_TCPIP_CORE();
+#endif
+        const err_t err = dns_gethostbyname(_serverName, &addr, dnsFound, this);
+#if ASYNC_NTP_LOCK_TCPIP
+        UNLOCK_TCPIP_CORE();
+#endif
+        if (ERR_OK == err)
+        { // numeric address, or cached by lwIP
+            _serverIP = ip_addr_get_ip4_u32(&addr);
+            _resolveState = NTP_RESOLVED;
+        }
+        else if (ERR_INPROGRESS != err)
+        {
+            _resolveState = NTP_UNRESOLVABLE;
+        }
+        return NTP_UNRESOLVABLE != _resolveState;
+    }
+#endif
+
+    /** Sends the request packet to the NTP server. */
+    bool sendPacket()
+    {
+        memset(_packetBuffer, 0, ASYNC_NTP_PACKET_SIZE);
+        _packetBuffer[0] = 0b11100011; // LI, Version, Mode
+        _packetBuffer[1] = 0;          // Stratum, or type of clock
+        _packetBuffer[2] = 6;          // Polling Interval
+        _packetBuffer[3] = 0xEC;       // Peer Clock Precision
+        // 8 bytes of zero for Root Delay & Root Dispersion
+        _packetBuffer[12] = 49;
+        _packetBuffer[13] = 0x4E;
+        _packetBuffer[14] = 49;
+        _packetBuffer[15] = 52;
+        _requestMs = millis();
+#if defined(ESP32) || defined(ESP8266)
+        _packetSent = _udp.beginPacket(IPAddress(_serverIP), ASYNC_NTP_PORT);
+        const bool sent = _packetSent;
+#else
+        const bool sent = _udp.beginPacket(_serverName, ASYNC_NTP_PORT);
+#endif
+        if (sent)
+        {
+            _udp.write(_packetBuffer, ASYNC_NTP_PACKET_SIZE);
+            _udp.endPacket();
+        }
+        return sent;
+    }
+
+    void fail()
+    {
+        _state = NTP_FAILED;
+#if defined(ESP32) || defined(ESP8266)
+        if (++_failures >= ASYNC_NTP_RESOLVE_AFTER_FAILURES)
+        { // server might have moved
+            _failures = 0;
+            if (NTP_RESOLVED == _resolveState)
+                _resolveState = NTP_UNRESOLVED;
+        }
+#endif
+    }
+
+public:
+    /**
+     * @param udp UDP instance to use, e.g. WiFiUDP
+     * @param serverName hostname of NTP server
+     * @param timeOffset in [s], added to UTC time (timezone)
+     */
+    AsyncNtpClient(UDP &udp, const char *serverName = "pool.ntp.org", const long timeOffset = 0) : _udp(udp), _serverName(serverName), _timeOffset(timeOffset) {}
+
+    void begin()
+    {
+        _udp.begin(ASYNC_NTP_LOCAL_PORT);
+        _udpSetup = true;
+    }
+
+    void setTimeOffset(const long timeOffset)
+    {
+        _timeOffset = timeOffset;
+    }
+
+    /**
+     * Sends a request to the NTP server and returns immediately.
+     * Note: on ESP32/ESP8266 the server name is resolved first if its address is not known, then the request is sent by poll() when resolved.
+     * @return false if request could not be sent
+     */
+    bool sendRequest()
+    {
+        if (!_udpSetup)
+            begin();
+        while (0 != _udp.parsePacket()) // discard late replies of previous requests
+            _udp.flush();
+        _requestMs = millis();
+#if defined(ESP32) || defined(ESP8266)
+        _packetSent = false;
+        if ((NTP_RESOLVED != _resolveState) && !resolve())
+        {
+            fail();
+            return false;
+        }
+        _state = NTP_PENDING;
+        if (NTP_RESOLVED != _resolveState)
+            return true; // sent by poll() when resolved
+#endif
+        const bool sent = sendPacket();
+        if (sent)
+            _state = NTP_PENDING;
+        else
+            fail();
+        return sent;
+    }
+
+    /**
+     * Checks for the reply of the NTP server, never blocks.
+     * NTP_SUCCESS and NTP_FAILED are returned only once per request, afterwards NTP_IDLE.
+     */
+    AsyncNtpState poll()
+    {
+        if (NTP_PENDING == _state)
+        {
+#if defined(ESP32) || defined(ESP8266)
+            if (!_packetSent && (NTP_RESOLVING != _resolveState))
+            { // resolved meanwhile
+                if ((NTP_RESOLVED != _resolveState) || !sendPacket())
+                {
+                    fail();
+                    _state = NTP_IDLE;
+                    return NTP_FAILED;
+                }
+            }
+            if (_packetSent && (_udp.parsePacket() >= ASYNC_NTP_PACKET_SIZE))
+#else
+            if (_udp.parsePacket() >= ASYNC_NTP_PACKET_SIZE)
+#endif
+            {
+                _udp.read(_packetBuffer, ASYNC_NTP_PACKET_SIZE);
+                const unsigned long secsSince1900 = ((unsigned long)_packetBuffer[40] << 24) | ((unsigned long)_packetBuffer[41] << 16) | ((unsigned long)_packetBuffer[42] << 8) | _packetBuffer[43];
+                _currentEpoch = secsSince1900 - ASYNC_NTP_SEVENTY_YEARS;
+                _lastUpdateMs = _requestMs + (millis() - _requestMs) / 2; // reply was sent half way of round trip
+                _state = NTP_SUCCESS;
+#if defined(ESP32) || defined(ESP8266)
+                _failures = 0;
+#endif
+            }
+            else if ((millis() - _requestMs) >= ASYNC_NTP_TIMEOUT)
+            {
+                fail();
+            }
+            if (NTP_PENDING == _state)
+                return _state;
+        } // a result is returned only once: by the call completing the request, or by the next one if sendRequest() failed
+        const AsyncNtpState result = _state;
+        _state = NTP_IDLE;
+        return result;
+    }
+
+    bool isPending() const
+    {
+        return NTP_PENDING == _state;
+    }
+
+    bool isTimeSet() const
+    {
+        return 0 != _lastUpdateMs;
+    }
+
+    /** @return seconds since 1970, including time offset */
+    unsigned long getEpochTime() const
+    {
+        return _timeOffset + _currentEpoch + ((millis() - _lastUpdateMs) / 1000);
+    }
+
+    /** @return time formatted like HH:MM:SS */
+    String getFormattedTime() const
+    {
+        const unsigned long rawTime = getEpochTime();
+        char buf[9];
+        snprintf_P(buf, sizeof(buf), PSTR("%02u:%02u:%02u"), (unsigned int)((rawTime % 86400L) / 3600), (unsigned int)((rawTime % 3600) / 60), (unsigned int)(rawTime % 60));
+        return String(buf);
+    }
+};
+#endif
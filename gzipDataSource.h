@@ -0,0 +1,253 @@
+/*
+GzipResponseDataSource - compresses the content of another response data source on the fly.
+
+Copyright (C) 2020  Matthias Clauß
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef GZIP_DATA_SOURCE_H
+#define GZIP_DATA_SOURCE_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <memory>
+
+#ifndef GZIP_WINDOW_SIZE
+#define GZIP_WINDOW_SIZE 1024 // size of LZ77 window, must be a power of 2, at most 32768
+#endif
+#ifndef GZIP_HASH_BITS
+#define GZIP_HASH_BITS 9 // size of hash table for finding matches: 2^GZIP_HASH_BITS entries
+#endif
+#ifndef GZIP_INPUT_CHUNK
+#define GZIP_INPUT_CHUNK 256 // how much content is read from the source at once
+#endif
+#define GZIP_MIN_SPACE 32 // minimum space in response buffer to make progress
+
+/**
+ * Delivers the content of source as gzip stream (RFC 1952), with a single deflate block of fixed Huffman codes (RFC 1951).
+ * Matches are searched in a small window without hash chains, which is fast and needs about 2.5KB per response,
+ * but still compresses logs and HTML templates considerably.
+ *
+ * Note: the source must deliver final content, so use it with TemplateResponseDataSource, but not with the template processor of AsyncWebServer.
+ * See sendGzipIfAccepted().
+ */
+class GzipResponseDataSource : public AwsResponseDataSource
+{
+private:
+    AwsResponseDataSource *_source;
+    size_t _sourceIndex = 0;
+    bool _started = false;
+    bool _finished = false;
+    uint32_t _pos = 0; // number of uncompressed bytes so far
+    uint32_t _crc = 0xFFFFFFFF;
+    uint32_t _bitBuf = 0;
+    uint8_t _bitCount = 0;
+    uint8_t *_out = nullptr;
+    size_t _outLen = 0;
+    uint16_t _head[1 << GZIP_HASH_BITS]; // position of last occurrence of 3 bytes (modulo 2^16)
+    uint8_t _window[GZIP_WINDOW_SIZE];
+    uint8_t _input[GZIP_INPUT_CHUNK];
+
+    void updateCrc(const uint8_t b)
+    {
+        static const uint32_t crcTable[16] = {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+        _crc = crcTable[(_crc ^ b) & 0x0F] ^ (_crc >> 4);
+        _crc = crcTable[(_crc ^ (b >> 4)) & 0x0F] ^ (_crc >> 4);
+    }
+
+    void putByte(const uint8_t b) { _out[_outLen++] = b; }
+    void putLong(const uint32_t v)
+    {
+        for (uint8_t i = 0; i < 32; i += 8)
+            putByte(v >> i);
+    }
+    /** Appends count (at most 16) bits of value, least significant bit first. */
+    void putBits(const uint32_t value, const uint8_t count)
+    {
+        _bitBuf |= value << _bitCount;
+        _bitCount += count;
+        while (_bitCount >= 8)
+        {
+            putByte(_bitBuf);
+            _bitBuf >>= 8;
+            _bitCount -= 8;
+        }
+    }
+    /** Appends Huffman code, which is stored starting with its most significant bit. */
+    void putCode(uint16_t code, const uint8_t len)
+    {
+        uint16_t reversed = 0;
+        for (uint8_t i = 0; i < len; ++i, code >>= 1)
+            reversed = (reversed << 1) | (code & 1);
+        putBits(reversed, len);
+    }
+    /** Appends literal/length symbol with fixed Huffman code. */
+    void putSymbol(const uint16_t symbol)
+    {
+        if (symbol < 144)
+            putCode(0x30 + symbol, 8);
+        else if (symbol < 256)
+            putCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280)
+            putCode(symbol - 256, 7);
+        else
+            putCode(0xC0 + symbol - 280, 8);
+    }
+    void putMatch(const uint16_t len, const uint16_t dist)
+    {
+        static const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const uint16_t distBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        uint8_t code = 28;
+        while (lengthBase[code] > len)
+            --code;
+        putSymbol(257 + code);
+        putBits(len - lengthBase[code], ((code < 8) || (28 == code)) ? 0 : (code - 4) / 4);
+        code = 29;
+        while (distBase[code] > dist)
+            --code;
+        putCode(code, 5);
+        putBits(dist - distBase[code], (code < 4) ? 0 : (code - 2) / 2);
+    }
+
+    static uint16_t hashOf(const uint8_t *in)
+    {
+        const uint32_t hash = ((uint32_t)in[0] << 16 | in[1] << 8 | in[2]) * (uint32_t)2654435761UL; // Fibonacci hashing
+        return hash >> (32 - GZIP_HASH_BITS);
+    }
+
+    /** Compresses in, output is at most 9 bits per byte. Matches do not reach beyond in. */
+    void compress(const uint8_t *in, const size_t n)
+    {
+        size_t i = 0;
+        while (i < n)
+        {
+            uint16_t len = 0;
+            uint16_t dist = 0;
+            if ((i + 2) < n)
+            {
+                const uint16_t hash = hashOf(&in[i]);
+                dist = (uint16_t)_pos - _head[hash];
+                _head[hash] = _pos;
+                if ((dist > 0) && (dist <= GZIP_WINDOW_SIZE) && (dist <= _pos))
+                {
+                    const size_t maxLen = ((n - i) < 258) ? (n - i) : 258;
+                    while ((len < maxLen) && (in[i + len] == ((len < dist) ? _window[(_pos + len - dist) & (GZIP_WINDOW_SIZE - 1)] : in[i + len - dist])))
+                        ++len;
+                }
+            }
+            if (len >= 3)
+                putMatch(len, dist);
+            else
+            {
+                len = 1;
+                putSymbol(in[i]);
+            }
+            for (; len > 0; --len, ++i, ++_pos)
+            {
+                _window[_pos & (GZIP_WINDOW_SIZE - 1)] = in[i];
+                updateCrc(in[i]);
+                if ((len > 1) && ((i + 3) < n))
+                    _head[hashOf(&in[i + 1])] = _pos + 1; // positions within match
+            }
+        }
+    }
+
+    /** End of block and gzip trailer, at most 10 bytes. */
+    void finish()
+    {
+        putSymbol(256);
+        if (_bitCount > 0)
+            putBits(0, 8 - _bitCount);
+        putLong(_crc ^ 0xFFFFFFFF);
+        putLong(_pos);
+        _finished = true;
+    }
+
+public:
+    /** @param source content to compress, is deleted with this */
+    GzipResponseDataSource(AwsResponseDataSource *source) : _source(source)
+    {
+        memset(_head, 0, sizeof(_head));
+    }
+
+    virtual size_t fillBuffer(uint8_t *buf, size_t maxLen, size_t)
+    {
+        if (_finished)
+            return 0;
+        if (maxLen < GZIP_MIN_SPACE)
+            return RESPONSE_TRY_AGAIN;
+        _out = buf;
+        _outLen = 0;
+        if (!_started)
+        { // gzip header: deflate, no flags, no time, unknown OS
+            static const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+            for (uint8_t i = 0; i < sizeof(header); ++i)
+                putByte(header[i]);
+            putBits(1, 1); // final block
+            putBits(1, 2); // fixed Huffman codes
+            _started = true;
+        }
+        while ((maxLen - _outLen) >= GZIP_MIN_SPACE)
+        {
+            size_t maxInputLen = ((maxLen - _outLen - 12) * 8) / 9; // keeps space for finish()
+            if (maxInputLen > GZIP_INPUT_CHUNK)
+                maxInputLen = GZIP_INPUT_CHUNK;
+            size_t inputLen = 0;
+            size_t len = 0;
+            do
+            { // collect input, matches are only found within
+                len = _source->fillBuffer(&_input[inputLen], maxInputLen - inputLen, _sourceIndex);
+                if (RESPONSE_TRY_AGAIN == len)
+                    break;
+                inputLen += len;
+                _sourceIndex += len;
+            } while ((len > 0) && (inputLen < maxInputLen));
+            compress(_input, inputLen);
+            if (RESPONSE_TRY_AGAIN == len)
+                return (_outLen > 0) ? _outLen : RESPONSE_TRY_AGAIN;
+            if (0 == len)
+            {
+                finish();
+                break;
+            }
+        }
+        return _outLen;
+    }
+
+    virtual ~GzipResponseDataSource()
+    {
+        delete _source;
+    }
+};
+
+/** @return if the browser accepts gzip encoded content */
+bool acceptsGzip(AsyncWebServerRequest *request)
+{
+    return request->hasHeader("Accept-Encoding") && (request->getHeader("Accept-Encoding")->value().indexOf("gzip") >= 0);
+}
+
+/**
+ * Sends the content of source as chunked response, compressed by GzipResponseDataSource if the browser accepts it.
+ * Example: <code>sendGzipIfAccepted(request, "text/html", new TemplateResponseDataSource(SPIFFS, "/log.html"));</code>
+ *
+ * @param source is deleted when the response is done
+ */
+void sendGzipIfAccepted(AsyncWebServerRequest *request, const String &contentType, AwsResponseDataSource *source)
+{
+    const bool gzip = acceptsGzip(request);
+    std::shared_ptr<AwsResponseDataSource> dataSource(gzip ? new GzipResponseDataSource(source) : source);
+    AsyncWebServerResponse *response = request->beginChunkedResponse(contentType, [dataSource](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+        return dataSource->fillBuffer(buf, maxLen, index);
+    });
+    if (gzip)
+        response->addHeader("Content-Encoding", "gzip");
+    request->send(response);
+}
+
+#endif
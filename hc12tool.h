@@ -37,6 +37,15 @@
  * }
  * </pre>
  * 
+ * To not block, e.g. when reconfiguring at runtime, start with beginConfigure() and call poll() from loop():<pre>
+ *   hc12Tool.beginConfigure(BPS115200, DBM20, 21, FU3);
+ *   // in loop():
+ *   if (HC12_CONFIGURE_BUSY != hc12Tool.poll()) { ... }
+ * </pre>
+ * 
+ * The baudrate detected at the module is kept in RTC memory (ESP32/ESP8266) and probed first after a warm reboot,
+ * so the scan of all baudrates is only needed if the module was reconfigured by someone else.
+ * 
  * Per default, received unexpected bytes and activity info is logged to Serial. This can be configured by calling
  * <pre>hc12Tool.setVerbosity();</pre>
  * and affects subsequent actions.
@@ -110,6 +119,39 @@ const char *const COMMAND_AT /*PROGMEM*/ = "AT\r\n";  // AT-command must be line
 const char *const RESPONSE_AT /*PROGMEM*/ = "OK\r\n"; // HC-12 terminates his responses always with \r\n (<13>,<10>)
 
 #define HC12_READCONFIGURATION_MAXBUFLEN 40 // experiment showed to expect 32 bytes
+#define HC12_COMMAND_MAXLEN 16
+
+#ifndef HC12_ENTER_COMMAND_MILLIS
+#define HC12_ENTER_COMMAND_MILLIS 41 // wait to enter command mode after set pin LOW
+#endif
+#ifndef HC12_EXIT_COMMAND_MILLIS
+#define HC12_EXIT_COMMAND_MILLIS 220 // wait to enter UART mode after set pin HIGH
+#endif
+#ifndef HC12_PROBE_SETTLE_MILLIS
+#define HC12_PROBE_SETTLE_MILLIS 10 // wait after changing local baudrate before probing
+#endif
+#ifndef HC12_RESPONSE_TIMEOUT
+#define HC12_RESPONSE_TIMEOUT 100 // [ms], max. wait for response of module
+#endif
+
+// last detected baudrate is kept over warm reboots, to be probed first
+#define HC12_BAUDRATE_CACHE_MAGIC 0x48433100 // "HC1" + index of Hc12_BaudRate
+#if defined(ESP32)
+RTC_NOINIT_ATTR uint32_t _hc12CachedBaudRate;
+#elif defined(ESP8266)
+#ifndef HC12_RTC_SLOT
+#define HC12_RTC_SLOT 127 // 4-byte block of RTC user memory (0..127)
+#endif
+#else
+uint32_t _hc12CachedBaudRate = 0;
+#endif
+
+enum Hc12_ConfigureStatus
+{
+    HC12_CONFIGURE_BUSY,
+    HC12_CONFIGURE_DONE,
+    HC12_CONFIGURE_FAILED // command mode not available or some setting failed
+};
 
 template <typename S>
 class Hc12Tool
@@ -141,33 +183,18 @@ public:
 
     void setParameters(Hc12_BaudRate baudRate, Hc12_TransmissionPower power)
     {
-        if (enterCommandMode(baudRate))
-        {
-            configureTransmissionPower(power);
-            configureBaudrate(baudRate);
-            exitCommandMode();
-        }
+        if (beginConfigure(baudRate, power))
+            finishConfigure();
     }
     void setParameters(Hc12_BaudRate baudRate, Hc12_TransmissionPower power, const uint8_t channel)
     {
-        if (enterCommandMode(baudRate))
-        {
-            configureChannel(channel);
-            configureTransmissionPower(power);
-            configureBaudrate(baudRate);
-            exitCommandMode();
-        }
+        if (beginConfigure(baudRate, power, channel))
+            finishConfigure();
     }
     void setParameters(Hc12_BaudRate baudRate, Hc12_TransmissionPower power, const uint8_t channel, Hc12_TransmissionMode mode)
     {
-        if (enterCommandMode(baudRate))
-        {
-            configureChannel(channel);
-            configureTransmissionPower(power);
-            configureTransmissionMode(mode);
-            configureBaudrate(baudRate); // must be the last command, as it adapts the baudrate of _hc12Serial
-            exitCommandMode();
-        }
+        if (beginConfigure(baudRate, power, channel, mode))
+            finishConfigure();
     }
 
     /**
@@ -179,36 +206,157 @@ public:
      */
     void setBaudrate(Hc12_BaudRate baudRate)
     {
-        if (enterCommandMode(baudRate))
-        {
-            configureBaudrate(baudRate);
-            exitCommandMode();
-        }
+        if (startConfigure(baudRate, baudRate, 0, 0, 0))
+            finishConfigure();
     }
 
     void setChannel(const uint8_t channel)
     {
-        if (enterCommandMode(BPS9600))
-        {
-            configureChannel(channel);
-            exitCommandMode();
-        }
+        if (startConfigure(BPS9600, -1, 0, channel, 0))
+            finishConfigure();
     }
     void setTransmissionPower(Hc12_TransmissionPower power)
     {
-        if (enterCommandMode(BPS9600))
-        {
-            configureTransmissionPower(power);
-            exitCommandMode();
-        }
+        if (startConfigure(BPS9600, -1, power, 0, 0))
+            finishConfigure();
     }
     void setTransmissionMode(Hc12_TransmissionMode mode)
     {
-        if (enterCommandMode(BPS9600))
+        if (startConfigure(BPS9600, -1, 0, 0, mode))
+            finishConfigure();
+    }
+
+    /**
+     * Starts configuration of the module without blocking, it is driven by subsequent calls of poll().
+     * Current settings are read at once (AT+RX), then only changed settings are set, baudrate last.
+     * 
+     * @param channel 1..127, 0 to leave unchanged
+     * @param mode one of <code>Hc12_TransmissionMode</code>, 0 to leave unchanged
+     * @return false if set pin is not configured or a configuration is still running
+     */
+    bool beginConfigure(Hc12_BaudRate baudRate, Hc12_TransmissionPower power, const uint8_t channel = 0, const uint8_t mode = 0)
+    {
+        return startConfigure(baudRate, baudRate, power, channel, mode);
+    }
+
+    /**
+     * Drives the configuration started with beginConfigure(), never blocks.
+     * @return HC12_CONFIGURE_BUSY while running, then result of the last configuration
+     */
+    Hc12_ConfigureStatus poll()
+    {
+        const unsigned long elapsed = millis() - _stateStart;
+        switch (_state)
         {
-            configureTransmissionMode(mode);
-            exitCommandMode();
+        case HC12_STATE_IDLE:
+            return _status;
+        case HC12_STATE_ENTER:
+            if (elapsed >= HC12_ENTER_COMMAND_MILLIS)
+            {
+                _probeStage = 0;
+                _probed = 0;
+                probeNext();
+            }
+            break;
+        case HC12_STATE_PROBE_SETTLE:
+            if (elapsed >= HC12_PROBE_SETTLE_MILLIS)
+            {
+                if (_waitForAvailableWrite && !_hc12Serial.availableForWrite())
+                {
+                    if (elapsed >= (unsigned long)(HC12_PROBE_SETTLE_MILLIS + _waitForAvailableWrite))
+                    {
+                        logActivity(F("hc12serial not available for write"));
+                        failProbe();
+                    }
+                    break;
+                }
+                dumpPendingBytes();
+                sendRequest(COMMAND_AT, HC12_STATE_PROBE);
+            }
+            break;
+        case HC12_STATE_PROBE:
+            if (readResponseLine())
+            {
+                if (endsWith(_response, "OK"))
+                { // tolerates unexpected bytes before response
+                    _verbosity.baudRateSet = true;
+                    logProbeSuccess();
+                    readConfiguration();
+                }
+                else
+                    dumpVerboseLine();
+            }
+            else if (elapsed >= HC12_RESPONSE_TIMEOUT)
+                probeNext();
+            break;
+        case HC12_STATE_READ_CONFIG:
+            if (readResponseLine())
+            {
+                matchConfiguration();
+                if (++_configLines < NUM_HC12_STEPS)
+                    setState(HC12_STATE_READ_CONFIG); // restart timeout
+                else
+                {
+                    _queried = true; // complete configuration read, only set-commands are left
+                    nextStep();
+                }
+            }
+            else if (elapsed >= HC12_RESPONSE_TIMEOUT)
+                nextStep(); // incomplete, query remaining settings one by one
+            break;
+        case HC12_STATE_QUERY:
+            if (readResponseLine() || (elapsed >= HC12_RESPONSE_TIMEOUT))
+            {
+                if (startsWith(_response, _expected))
+                {
+                    logAlreadySet();
+                    nextStep();
+                }
+                else
+                {
+                    dumpVerboseLine();
+                    dumpPendingBytes();
+                    HC12TOOL_DEBUG(F("sending set-command: "))
+                    stepCommand(true);
+                    sendRequest(_command, HC12_STATE_SET);
+                }
+            }
+            break;
+        case HC12_STATE_SET:
+            if (readResponseLine() || (elapsed >= HC12_RESPONSE_TIMEOUT))
+            {
+                if (0 == strcmp(_response, _expected))
+                {
+                    logActivity(F("  successfully set "));
+                    logActivity(stepName());
+                    logActivity(_value);
+                    if (HC12_STEP_BAUDRATE == _step)
+                    {
+                        storeCachedBaudRate(_baudRate);
+                        changeBaudRate(HC12_BAUDRATE_NUMERIC[_baudRate], true);
+                    }
+                }
+                else
+                {
+                    logActivity(F("unexpected response to "));
+                    logActivity(_command);
+                    _status = HC12_CONFIGURE_FAILED;
+                    if ((HC12_STEP_BAUDRATE == _step) && (0 < _fallbackSerialTo))
+                    {
+                        logActivity(F("\n  setting baudrate to fallback"));
+                        changeBaudRate(_fallbackSerialTo, true);
+                    }
+                }
+                logActivity(F("\n"));
+                nextStep();
+            }
+            break;
+        case HC12_STATE_EXIT:
+            if (elapsed >= HC12_EXIT_COMMAND_MILLIS)
+                _state = HC12_STATE_IDLE;
+            break;
         }
+        return (HC12_STATE_IDLE == _state) ? _status : HC12_CONFIGURE_BUSY;
     }
 
     /**
@@ -287,6 +435,27 @@ public:
     }
 
 private:
+    enum Hc12ConfigureState : byte
+    {
+        HC12_STATE_IDLE,
+        HC12_STATE_ENTER,        // set pin is LOW, waiting for command mode
+        HC12_STATE_PROBE_SETTLE, // local baudrate changed, waiting before probing
+        HC12_STATE_PROBE,        // "AT" sent, waiting for "OK"
+        HC12_STATE_READ_CONFIG,  // "AT+RX" sent, receiving complete configuration
+        HC12_STATE_QUERY,        // query of current setting sent
+        HC12_STATE_SET,          // set-command sent
+        HC12_STATE_EXIT          // set pin is HIGH, waiting for UART mode
+    };
+    // in order of execution: baudrate must be last, as it adapts the baudrate of _hc12Serial
+    enum Hc12ConfigureStep : byte
+    {
+        HC12_STEP_CHANNEL,
+        HC12_STEP_POWER,
+        HC12_STEP_MODE,
+        HC12_STEP_BAUDRATE,
+        NUM_HC12_STEPS
+    };
+
     uint8_t _setPinNo;
     S &_hc12Serial;
     uint32_t _fallbackSerialTo;
@@ -294,381 +463,440 @@ private:
     Hc12toolVerbosity _verbosity = {true, true, false};
     Print &_debug = Serial;
 
-    /** send command and wait for specific response */
-    boolean sendValidatedCommand(const char *command, const char *expectedResponse, const bool tolerateUnexpected)
+    Hc12ConfigureState _state = HC12_STATE_IDLE;
+    Hc12_ConfigureStatus _status = HC12_CONFIGURE_DONE;
+    unsigned long _stateStart = 0;
+    uint8_t _steps = 0; // bit mask of Hc12ConfigureStep still to do
+    Hc12ConfigureStep _step = HC12_STEP_CHANNEL;
+    Hc12_BaudRate _probeBaudRate = BPS9600; // preferred baudrate for probing
+    uint8_t _probeStage = 0;
+    uint8_t _probed = 0;    // bit mask of already probed Hc12_BaudRate
+    int8_t _probeBaud = -1; // currently probed Hc12_BaudRate, -1 for unchanged local baudrate
+    Hc12_BaudRate _baudRate = BPS9600;
+    uint8_t _power = 0;
+    uint8_t _channel = 0;
+    uint8_t _mode = 0;
+    char _command[HC12_COMMAND_MAXLEN];
+    char _expected[HC12_COMMAND_MAXLEN];
+    uint8_t _configLines = 0; // lines received of "AT+RX"
+    bool _queried = false;    // true if current settings of remaining steps are known to differ
+    uint8_t _queryPrefixLen = 0; // where the value starts in expected query response
+    char _value[7];              // value of set-command, 6 chars for "115200" incl. \0-terminator
+    char _response[HC12_READCONFIGURATION_MAXBUFLEN + 1];
+    uint8_t _responseLen = 0;
+
+    /**
+     * Validates the settings and enters command mode.
+     * @param baudRate to set, or -1 to leave unchanged
+     */
+    bool startConfigure(Hc12_BaudRate probeBaudRate, const int baudRate, const uint8_t power, const uint8_t channel, const uint8_t mode)
     {
-        if (tolerateUnexpected && _waitForAvailableWrite)
+        if (!_setPinNo || !_hc12Serial || (HC12_STATE_IDLE != _state))
+            return false;
+        _steps = 0;
+        _probeBaudRate = probeBaudRate;
+        if (baudRate >= 0)
         {
-            uint8_t writeCycles = _waitForAvailableWrite;
-            while (!_hc12Serial.availableForWrite() && writeCycles > 0)
+            if (BPS1200 <= baudRate && baudRate <= BPS115200)
             {
-                --writeCycles;
-                delay(1);
+                _baudRate = (Hc12_BaudRate)baudRate;
+                _steps |= 1 << HC12_STEP_BAUDRATE;
             }
-            if (!writeCycles)
+            else
+                logActivity(F("invalid baudrate"));
+        }
+        if (power)
+        {
+            if (DBMminus1 <= power && power <= DBM20)
             {
-                logActivity(F("hc12serial not available for write"));
-                return false;
+                _power = power;
+                _steps |= 1 << HC12_STEP_POWER;
             }
+            else
+                logActivity(F("invalid power"));
         }
-        sendCommand(command);
-        return readExpectedResponse(expectedResponse, tolerateUnexpected, false);
-    }
-    void sendCommand(const char *command)
-    {
-        /* TODO: does not work, try again later?
-        const char *pgmStr = command;
-        char c;
-        while ('\0' != (c = pgm_read_byte(pgmStr++)))
+        if (channel)
         {
-            HC12TOOL_DEBUG(c);
-            _hc12Serial.write(c);
+            if (channel <= 127)
+            {
+                _channel = channel;
+                _steps |= 1 << HC12_STEP_CHANNEL;
+            }
+            else
+                logActivity(F("invalid channel"));
         }
-        */
-        _hc12Serial.write(command, strlen(command));
-        _hc12Serial.flush(); // wait till command has been fully sent
+        if (mode)
+        {
+            if (FU1 <= mode && mode <= FU4)
+            {
+                _mode = mode;
+                _steps |= 1 << HC12_STEP_MODE;
+            }
+            else
+                logActivity(F("invalid mode"));
+        }
+        // read any bytes still in buffer/transmission
+        dumpPendingBytes();
+        logActivity(F("\nConfiguring HC-12: "));
+        _status = HC12_CONFIGURE_DONE;
+        pinMode(_setPinNo, OUTPUT);
+        digitalWrite(_setPinNo, LOW);
+        setState(HC12_STATE_ENTER);
+        return true;
     }
 
-    void changeBaudRate(unsigned long baudRate, const bool forceSet)
+    /** blocking variant: wait till configuration is done */
+    void finishConfigure()
     {
-        _hc12Serial.flush();         // always write pending data in TX-FIFO
-        _hc12Serial.begin(baudRate); // we always have to use begin(), since SoftwareSerial does not support updateBaudRate()
-        logActivity(F("  set serial-baudrate to "));
-        if (_verbosity.printActivityInfo)
-            _debug.println(baudRate);
+        while (HC12_CONFIGURE_BUSY == poll())
+            delay(1);
     }
 
-    void dumpVerboseChar(const char c)
+    void setState(const Hc12ConfigureState state)
     {
-        if (_verbosity.showUnexpectedBytes)
-            _debug.write(c);
+        _state = state;
+        _stateStart = millis();
     }
-    void dumpPendingBytes()
+
+    void sendRequest(const char *command, const Hc12ConfigureState state)
     {
-        if (_verbosity.showUnexpectedBytes)
+        HC12TOOL_DEBUG(command)
+        _responseLen = 0;
+        _response[0] = '\0';
+        sendCommand(command);
+        setState(state);
+    }
+
+    /** collects response line of module, without "\r\n"; @return true if _response holds a complete line */
+    bool readResponseLine()
+    {
+        while (_hc12Serial.available())
         {
-            if (_hc12Serial.available())
+            const char c = _hc12Serial.read();
+            if ('\n' == c)
             {
-                _debug.print(F("<unexpected>"));
-                while (_hc12Serial.available())
-                    _debug.write(_hc12Serial.read());
-                _debug.print(F("</unexpected>"));
-                _debug.println();
+                _responseLen = 0;
+                return true;
+            }
+            if (('\r' != c) && (_responseLen < HC12_READCONFIGURATION_MAXBUFLEN))
+            {
+                _response[_responseLen++] = c;
+                _response[_responseLen] = '\0';
             }
         }
-        else
-        {
-            while (_hc12Serial.available())
-                _hc12Serial.read();
-        }
+        return false;
     }
 
-    void logActivity(const __FlashStringHelper *msg)
+    static bool startsWith(const char *str, const char *prefix)
     {
-        if (_verbosity.printActivityInfo)
-        {
-            _debug.print(msg);
-        }
+        return 0 == strncmp(str, prefix, strlen(prefix));
     }
-    void logActivity(const char *value)
+    static bool endsWith(const char *str, const char *suffix)
     {
-        if (_verbosity.printActivityInfo)
-        {
-            _debug.print(value);
-        }
+        const size_t len = strlen(str);
+        const size_t suffixLen = strlen(suffix);
+        return (len >= suffixLen) && (0 == strcmp(&str[len - suffixLen], suffix));
     }
-    void logActivity(const uint32_t &value)
+
+    /**
+     * Changes local baudrate to the next one to probe and waits to settle.
+     * Order: cached baudrate of last detection (if none: keep current), then preferred, default of HC-12 and all others, each only once.
+     */
+    void probeNext()
     {
-        if (_verbosity.printActivityInfo)
+        while (_probeStage < (NUM_HC12_BAUDRATES + 3))
         {
-            _debug.print(value);
+            const uint8_t stage = _probeStage++;
+            int8_t baudRate;
+            if (0 == stage)
+            {
+                baudRate = loadCachedBaudRate();
+                if (baudRate < 0)
+                { // probe current local baudrate
+                    _probeBaud = -1;
+                    setState(HC12_STATE_PROBE_SETTLE);
+                    return;
+                }
+            }
+            else if (1 == stage)
+                baudRate = _probeBaudRate;
+            else if (2 == stage)
+                baudRate = BPS9600;
+            else
+                baudRate = stage - 3;
+            if (!(_probed & (1 << baudRate)))
+            {
+                _probed |= 1 << baudRate;
+                _probeBaud = baudRate;
+                dumpPendingBytes();
+                changeBaudRate(HC12_BAUDRATE_NUMERIC[baudRate], false);
+                setState(HC12_STATE_PROBE_SETTLE);
+                return;
+            }
         }
+        failProbe();
     }
 
-    bool enterCommandMode(Hc12_BaudRate baudRate)
+    void logProbeSuccess()
     {
-        if (!_setPinNo || !_hc12Serial)
-            return false;
-        // read any bytes still in buffer/transmission
-        dumpPendingBytes();
-        logActivity(F("\nConfiguring HC-12: "));
-        pinMode(_setPinNo, OUTPUT);
-        digitalWrite(_setPinNo, LOW);
-        delay(41); // wait to enter command mode
-        // 1st attempt communication with HC-12 with pre-set baudrate
-        if (sendValidatedCommand(COMMAND_AT, RESPONSE_AT, true)) // TODO what will happen with an unitialized UART?
-        {
-            _verbosity.baudRateSet = true;
-            return true;
-        }
-        else
+        if (_probeBaud >= 0)
         {
-            // 1st try with preferred baudrate, in case it is already set at the module
-            dumpPendingBytes();
-            changeBaudRate(HC12_BAUDRATE_NUMERIC[baudRate], false);
-            if (sendValidatedCommand(COMMAND_AT, RESPONSE_AT, true))
+            storeCachedBaudRate(_probeBaud);
+            if (_probeStage > 1)
             {
-                _verbosity.baudRateSet = true;
-                logActivity(F("  hc12serial found at preferred baudrate, "));
-                return true;
-            }
-            else
-            {
-                // 2nd: try default of HC-12
-                changeBaudRate(9600, false);
-                if (sendValidatedCommand(COMMAND_AT, RESPONSE_AT, true))
-                {
-                    _verbosity.baudRateSet = true;
-                    logActivity(F(" hc12serial found at 9600 baud, "));
-                    return true;
-                }
-                else
-                    // try all existing baudrates
-                    for (int i = 0; i < NUM_HC12_BAUDRATES; ++i)
-                    {
-                        changeBaudRate(HC12_BAUDRATE_NUMERIC[i], false);
-                        _hc12Serial.flush();
-                        delay(10);
-                        dumpPendingBytes();
-                        if (sendValidatedCommand(COMMAND_AT, RESPONSE_AT, false))
-                        {
-                            _verbosity.baudRateSet = true;
-                            logActivity(F(" found hc12serial at "));
-                            logActivity(HC12_BAUDRATE_NUMERIC[i]);
-                            logActivity(F(" baud, "));
-                            return true;
-                        }
-                    }
+                logActivity(F("  found hc12serial at "));
+                logActivity(HC12_BAUDRATE_NUMERIC[_probeBaud]);
+                logActivity(F(" baud, "));
             }
         }
+    }
+
+    /** @return index of baudrate detected before (e.g. before a warm reboot), -1 if not available */
+    static int8_t loadCachedBaudRate()
+    {
+        uint32_t cached;
+#if defined(ESP8266)
+        if (!ESP.rtcUserMemoryRead(HC12_RTC_SLOT, &cached, sizeof(cached)))
+            return -1;
+#else
+        cached = _hc12CachedBaudRate;
+#endif
+        return ((HC12_BAUDRATE_CACHE_MAGIC == (cached & 0xFFFFFF00)) && ((cached & 0xFF) < NUM_HC12_BAUDRATES)) ? (cached & 0xFF) : -1;
+    }
+    static void storeCachedBaudRate(const uint8_t baudRate)
+    {
+        if (loadCachedBaudRate() == baudRate)
+            return;
+        uint32_t cached = HC12_BAUDRATE_CACHE_MAGIC | baudRate;
+#if defined(ESP8266)
+        ESP.rtcUserMemoryWrite(HC12_RTC_SLOT, &cached, sizeof(cached));
+#else
+        _hc12CachedBaudRate = cached;
+#endif
+    }
 
+    void failProbe()
+    {
+        logActivity(F(" -> command mode not available"));
         if (0 < _fallbackSerialTo)
         {
-            logActivity(F(" -> command mode not available, setting local to fallback"));
+            logActivity(F(", setting local to fallback"));
             changeBaudRate(_fallbackSerialTo, false);
         }
-        else
-            logActivity(F(" -> command mode not available"));
-        return false;
+        _status = HC12_CONFIGURE_FAILED;
+        exitCommandMode();
     }
-    void exitCommandMode()
+
+    /**
+     * Reads the complete configuration with a single "AT+RX" if more than one setting is to be configured,
+     * so only the set-commands for changed settings need to be sent.
+     */
+    void readConfiguration()
     {
-        digitalWrite(_setPinNo, HIGH);
-        // 80ms wait to enter UART mode; 200ms to avoid resetting default UART mode (9600, 8N1) with entering command mode again
-        delay(220);
+        _queried = false;
+        uint8_t numSteps = 0;
+        for (uint8_t step = 0; step < NUM_HC12_STEPS; ++step)
+            if (_steps & (1 << step))
+                ++numSteps;
+        if (numSteps > 1)
+        {
+            _configLines = 0;
+            HC12TOOL_DEBUG(F("[query='"))
+            sendRequest("AT+RX", HC12_STATE_READ_CONFIG);
+        }
+        else
+            nextStep();
     }
 
-    void ignoreEndOfLine(bool consumeOtherChars)
+    /** removes the step whose setting is reported by the "AT+RX" response line in _response */
+    void matchConfiguration()
     {
-        int waitCycles = 30; // we need 4 cycles at least for AT+RP response
-        uint8_t state = 0;
-        HC12TOOL_DEBUG("\nIgnoring...")
-        while (waitCycles)
+        for (uint8_t step = 0; step < NUM_HC12_STEPS; ++step)
         {
-            int x = -1;
-            HC12TOOL_DEBUG("i");
-            while (_hc12Serial.available())
+            if (_steps & (1 << step))
             {
-                x = _hc12Serial.read();
-                HC12TOOL_DEBUG(" c:")
-                HC12TOOL_DEBUG(x)
-                if ('\r' == x)
-                {
-                    state = 1;
-                    break;
-                }
-                else if ('\n' == x)
+                _step = (Hc12ConfigureStep)step;
+                stepCommand(false);
+                if (startsWith(_response, _expected))
                 {
-                    state = (1 == state) ? 2 : 0;
-                    break;
+                    _steps &= ~(1 << step);
+                    logAlreadySet();
+                    return;
                 }
-                else if (!consumeOtherChars)
-                    break;
             }
-            if (2 == state)
-                break; // terminating with EOL found
-            HC12TOOL_DEBUG("|")
-            if (-1 != x)
-                dumpVerboseChar((char)x);
-            delay(1); // to decouple wait cycles from processing speed
-            --waitCycles;
         }
-        HC12TOOL_DEBUG(" done.\n")
     }
 
-    /** wait for specific response, return true if found */
-    // note: each response from HC-12 is termined by "\r\n" (<13>,<10>)
-    boolean readExpectedResponse(const char *expectedResponse, const bool tolerateUnexpected, const bool acceptTerminators)
+    void logAlreadySet()
     {
-        size_t responsePos = 0;
-        uint8_t readCycles = 100; // maximum number of wait cycles to wait for incoming response
+        logActivity(F("  "));
+        logActivity(stepName());
+        logActivity(&_expected[_queryPrefixLen]);
+        logActivity(F(" already set\n"));
+        if (HC12_STEP_BAUDRATE == _step)
+            storeCachedBaudRate(_baudRate);
+    }
 
-        char expectedByte = expectedResponse[responsePos]; // preparation for algorithm with for progmem usage
-        while ('\0' != expectedByte && (readCycles > 0))
+    /** continues with next configuration step, or exits command mode if all done */
+    void nextStep()
+    {
+        for (uint8_t step = 0; step < NUM_HC12_STEPS; ++step)
         {
-            if (!_hc12Serial.available())
+            if (_steps & (1 << step))
             {
-                --readCycles;
-                delay(1);
-            }
-            while (('\0' != expectedByte) && _hc12Serial.available())
-            {
-                const int x = _hc12Serial.read();
-                if (x == expectedByte)
+                _steps &= ~(1 << step);
+                _step = (Hc12ConfigureStep)step;
+                if (_queried)
                 {
-                    ++responsePos;
-                    expectedByte = expectedResponse[responsePos];
-                    HC12TOOL_DEBUG('{')
-                    HC12TOOL_DEBUG((char)x)
-                    HC12TOOL_DEBUG('}')
+                    HC12TOOL_DEBUG(F("sending set-command: "))
+                    stepCommand(true);
+                    sendRequest(_command, HC12_STATE_SET);
                 }
                 else
-                { // got something else
-                    HC12TOOL_DEBUG('<')
-                    HC12TOOL_DEBUG(x)
-                    HC12TOOL_DEBUG('>')
-                    dumpVerboseChar((char)x);
-                    if (tolerateUnexpected)
-                    {
-                        responsePos = 0;
-                        expectedByte = expectedResponse[responsePos];
-                    }
-                    else
-                    {
-                        return false;
-                    }
+                {
+                    HC12TOOL_DEBUG(F("[query='"))
+                    stepCommand(false);
+                    sendRequest(_command, HC12_STATE_QUERY);
                 }
+                return;
             }
         }
-        // read+consume terminating newline
-        if (acceptTerminators)
-            ignoreEndOfLine(false);
-        // got the expected response?
-        return '\0' == expectedByte;
-    }
-
-    /** @return true if successful */
-    bool configure(const char *queryCommand, const char *expectedQueryResponse, char *expectedQueryValue,
-                   const char *setCommand, char *commandValue, const char *expectedSetResponse,
-                   const __FlashStringHelper *successMessage)
-    {
-        HC12TOOL_DEBUG(F("[query='"))
-        HC12TOOL_DEBUG(queryCommand)
-        HC12TOOL_DEBUG(F("', expecting='"))
-        HC12TOOL_DEBUG(expectedQueryResponse)
-        HC12TOOL_DEBUG(expectedQueryValue)
-        HC12TOOL_DEBUG(F("'] -> "))
-        sendCommand(queryCommand);
-        if (readExpectedResponse(expectedQueryResponse, false, false) && readExpectedResponse(expectedQueryValue, false, true))
-        {
-            logActivity(F("  "));
-            logActivity(successMessage);
-            logActivity(expectedQueryValue);
-            logActivity(F(" already set\n"));
-            return true;
-        }
-        else
+        exitCommandMode();
+    }
+
+    void exitCommandMode()
+    {
+        digitalWrite(_setPinNo, HIGH);
+        setState(HC12_STATE_EXIT);
+    }
+
+    const __FlashStringHelper *stepName() const
+    {
+        switch (_step)
         {
-            ignoreEndOfLine(true); // ignore remaing response to query command
-            dumpPendingBytes();
-            // digitalWrite(_setPinNo, HIGH);
-            // delay(280); // wait 80ms to exit command mode
-            // digitalWrite(_setPinNo, LOW);
-            // delay(41); // wait to enter command mode
-            HC12TOOL_DEBUG(F("sending set-command: "))
-            sendCommand(setCommand);
-            bool result = false;
-            if (sendValidatedCommand(commandValue, expectedSetResponse, false))
-            {
-                if (readExpectedResponse(commandValue, false, true))
-                {
-                    logActivity(F("  successfully set "));
-                    logActivity(successMessage);
-                    logActivity(commandValue);
-                    result = true;
-                }
-                else
-                {
-                    logActivity(F("unexpected response to "));
-                    logActivity(setCommand);
-                    logActivity(commandValue);
-                }
-            }
-            else
-            {
-                logActivity(F("failed sending command "));
-                logActivity(setCommand);
-                logActivity(commandValue);
-            }
-            logActivity(F("\n"));
-            return result;
+        case HC12_STEP_CHANNEL:
+            return F("channel ");
+        case HC12_STEP_POWER:
+            return F("transmission power ");
+        case HC12_STEP_MODE:
+            return F("transmission mode FU");
+        default:
+            return F("baudrate ");
         }
     }
 
-    // "AT+RB" - query baudrate: response should be: "OK+B9600"
-    void configureBaudrate(Hc12_BaudRate baudRate)
+    /**
+     * Prepares _command and _expected response for current step.
+     * @param set true for set-command (answered with "OK" instead of "AT"), false for query
+     */
+    void stepCommand(const bool set)
     {
-        if (BPS1200 <= baudRate && baudRate <= BPS115200)
+        switch (_step)
         {
-            char str[7]; // 6 chars for "115200" incl. \0-terminator
-            snprintf_P(str, 7, PSTR("%lu"), HC12_BAUDRATE_NUMERIC[baudRate]);
-            if (configure("AT+RB", "OK+B", str, "AT+B", str, "OK+B", F("baudrate ")))
-            {
-                changeBaudRate(HC12_BAUDRATE_NUMERIC[baudRate], true);
-            }
+        case HC12_STEP_CHANNEL: // AT+Cxxx / response should be: OK+C021
+            snprintf_P(_value, sizeof(_value), PSTR("%03u"), _channel);
+            snprintf_P(_command, HC12_COMMAND_MAXLEN, set ? PSTR("AT+C%s") : PSTR("AT+RC"), _value);
+            snprintf_P(_expected, HC12_COMMAND_MAXLEN, set ? PSTR("OK+C%s") : PSTR("OK+RC%s"), _value);
+            _queryPrefixLen = 5;
+            break;
+        case HC12_STEP_POWER: // query response is: OK+RP:+20dBm
+            snprintf_P(_value, sizeof(_value), PSTR("%d"), _power);
+            snprintf_P(_command, HC12_COMMAND_MAXLEN, set ? PSTR("AT+P%s") : PSTR("AT+RP"), _value);
+            if (set)
+                snprintf_P(_expected, HC12_COMMAND_MAXLEN, PSTR("OK+P%s"), _value);
             else
-            {
-                if (0 < _fallbackSerialTo)
-                {
-                    logActivity(F("  setting baudrate to fallback\n"));
-                    changeBaudRate(_fallbackSerialTo, true);
-                }
-            }
+                snprintf_P(_expected, HC12_COMMAND_MAXLEN, PSTR("OK+RP:%0+3ddBm"), (_power - 1) * 3 - 1);
+            _queryPrefixLen = 6;
+            break;
+        case HC12_STEP_MODE:
+            snprintf_P(_value, sizeof(_value), PSTR("%u"), _mode);
+            snprintf_P(_command, HC12_COMMAND_MAXLEN, set ? PSTR("AT+FU%s") : PSTR("AT+RF"), _value);
+            snprintf_P(_expected, HC12_COMMAND_MAXLEN, PSTR("OK+FU%s"), _value);
+            _queryPrefixLen = 5;
+            break;
+        default: // "AT+RB" - query baudrate: response should be: "OK+B9600"
+            snprintf_P(_value, sizeof(_value), PSTR("%lu"), HC12_BAUDRATE_NUMERIC[_baudRate]);
+            snprintf_P(_command, HC12_COMMAND_MAXLEN, set ? PSTR("AT+B%s") : PSTR("AT+RB"), _value);
+            snprintf_P(_expected, HC12_COMMAND_MAXLEN, PSTR("OK+B%s"), _value);
+            _queryPrefixLen = 4;
+            break;
         }
-        else
-            logActivity(F("invalid baudrate"));
     }
 
-    // AT+Cxxx / response should be: OK+C021
-    void configureChannel(const uint8_t channel)
+    void dumpVerboseLine()
     {
-        if (0 < channel && channel <= 127)
+        if (_verbosity.showUnexpectedBytes && ('\0' != _response[0]))
+            _debug.println(_response);
+    }
+
+    void sendCommand(const char *command)
+    {
+        /* TODO: does not work, try again later?
+        const char *pgmStr = command;
+        char c;
+        while ('\0' != (c = pgm_read_byte(pgmStr++)))
         {
-            char str[4]; // 3 digits with leading 0 + \0-terminator
-            snprintf_P(str, 4, PSTR("%03u"), channel);
-            configure("AT+RC", "OK+RC", str, "AT+C", str, "OK+C", F("channel "));
+            HC12TOOL_DEBUG(c);
+            _hc12Serial.write(c);
         }
-        else
-            logActivity(F("invalid channel"));
+        */
+        _hc12Serial.write(command, strlen(command));
+        _hc12Serial.flush(); // wait till command has been fully sent
+    }
+
+    void changeBaudRate(unsigned long baudRate, const bool forceSet)
+    {
+        _hc12Serial.flush();         // always write pending data in TX-FIFO
+        _hc12Serial.begin(baudRate); // we always have to use begin(), since SoftwareSerial does not support updateBaudRate()
+        logActivity(F("  set serial-baudrate to "));
+        if (_verbosity.printActivityInfo)
+            _debug.println(baudRate);
+    }
+
+    void dumpVerboseChar(const char c)
+    {
+        if (_verbosity.showUnexpectedBytes)
+            _debug.write(c);
     }
-    void configureTransmissionPower(Hc12_TransmissionPower power)
+    void dumpPendingBytes()
     {
-        if (DBMminus1 <= power && power <= DBM20)
+        if (_verbosity.showUnexpectedBytes)
         {
-            // response is: OK+RP:+20 dBm
-            char str[4]; // 3 digits with leading 0 + \0-terminator
-            snprintf_P(str, 4, PSTR("%d"), power);
-            char str2[8];
-            snprintf_P(str2, 8, PSTR("%0+3ddBm"), (power - 1) * 3 - 1);
-            configure("AT+RP", "OK+RP:", str2, "AT+P", str, "OK+P", F("transmission power "));
+            if (_hc12Serial.available())
+            {
+                _debug.print(F("<unexpected>"));
+                while (_hc12Serial.available())
+                    _debug.write(_hc12Serial.read());
+                _debug.print(F("</unexpected>"));
+                _debug.println();
+            }
         }
         else
         {
-            logActivity(F("invalid power"));
+            while (_hc12Serial.available())
+                _hc12Serial.read();
         }
     }
-    void configureTransmissionMode(Hc12_TransmissionMode mode)
+
+    void logActivity(const __FlashStringHelper *msg)
     {
-        char str[2];                   // 3 digits with leading 0 + \0-terminator
-        str[0] = ((uint8_t)mode) + 48; // 48 is decimal for '0
-        str[1] = '\0';
-        if (FU1 <= mode && mode <= FU4)
+        if (_verbosity.printActivityInfo)
         {
-            configure("AT+RF", "OK+FU", str, "AT+FU", str, "OK+FU", F("transmission mode FU"));
+            _debug.print(msg);
         }
-        else
+    }
+    void logActivity(const char *value)
+    {
+        if (_verbosity.printActivityInfo)
         {
-            logActivity(F("invalid mode"));
+            _debug.print(value);
+        }
+    }
+    void logActivity(const uint32_t &value)
+    {
+        if (_verbosity.printActivityInfo)
+        {
+            _debug.print(value);
         }
     }
 };
@@ -0,0 +1,137 @@
+/*
+HeapMonitor - samples free heap, largest free block, fragmentation and stack watermark into a ring.
+
+Copyright (C) 2020  Matthias Clauß
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+
+#ifndef UNIVERSALUI_HEAP_SAMPLE_INTERVAL
+#define UNIVERSALUI_HEAP_SAMPLE_INTERVAL 60000 // [ms]
+#endif
+#ifndef UNIVERSALUI_HEAP_SAMPLES
+#define UNIVERSALUI_HEAP_SAMPLES 32 // number of samples kept, older ones are overwritten
+#endif
+#if UNIVERSALUI_HEAP_SAMPLES > 255
+#error "UNIVERSALUI_HEAP_SAMPLES must not exceed 255"
+#endif
+
+struct HeapSample
+{
+    uint32_t millis;
+    uint32_t freeHeap;     // [bytes]
+    uint32_t maxFreeBlock; // largest allocatable block [bytes]
+    uint32_t minFreeStack; // minimum free stack of arduino loop since start [bytes]
+    uint8_t fragmentation; // [%]
+};
+
+/**
+ * Records heap and stack state at fixed interval, to follow the trend over weeks of uptime.
+ * Driven by <code>UniversalUI::handle()</code> if <code>UNIVERSALUI_HEAP_MONITOR</code> is defined.
+ * Published via placeholder <code>%HEAP%</code> and <code>handleHeap()</code> (CSV), see webUiGenericPlaceHolder.h.
+ */
+class HeapMonitor
+{
+private:
+    HeapSample _samples[UNIVERSALUI_HEAP_SAMPLES];
+    uint8_t _next = 0;  // index of next sample to write
+    uint8_t _count = 0; // number of valid samples
+    unsigned long _lastSampleMillis = 0;
+#if defined(ESP32)
+    TaskHandle_t _task = NULL; // whose stack is watched, NULL for the calling task
+#endif
+
+public:
+    /** Takes a sample if interval elapsed, to be called in <code>loop()</code>. */
+    void handle()
+    {
+        if ((0 == _count) || ((millis() - _lastSampleMillis) >= UNIVERSALUI_HEAP_SAMPLE_INTERVAL))
+            sample();
+    }
+
+    /** Takes a sample now. */
+    void sample()
+    {
+        _lastSampleMillis = millis();
+        HeapSample &s = _samples[_next];
+        s.millis = _lastSampleMillis;
+#if defined(ESP32)
+        s.freeHeap = ESP.getFreeHeap();
+        s.maxFreeBlock = ESP.getMaxAllocHeap();
+        s.fragmentation = (s.freeHeap > 0) ? (100 - (uint32_t)((uint64_t)s.maxFreeBlock * 100 / s.freeHeap)) : 0;
+        s.minFreeStack = uxTaskGetStackHighWaterMark(_task);
+#elif defined(ESP8266)
+        s.freeHeap = ESP.getFreeHeap();
+        s.maxFreeBlock = ESP.getMaxFreeBlockSize();
+        s.fragmentation = ESP.getHeapFragmentation();
+        s.minFreeStack = ESP.getFreeContStack();
+#else
+        s.freeHeap = 0;
+        s.maxFreeBlock = 0;
+        s.fragmentation = 0;
+        s.minFreeStack = 0;
+#endif
+        _next = (_next + 1) % UNIVERSALUI_HEAP_SAMPLES;
+        if (_count < UNIVERSALUI_HEAP_SAMPLES)
+            ++_count;
+    }
+
+#if defined(ESP32)
+    /** Watches the stack of the given task instead of the one calling sample(). */
+    void setTask(TaskHandle_t task) { _task = task; }
+#endif
+
+    uint8_t getSampleCount() const { return _count; }
+    /** @param i 0 for oldest sample, getSampleCount()-1 for latest */
+    const HeapSample &getSample(const uint8_t i) const
+    {
+        return _samples[(_next + UNIVERSALUI_HEAP_SAMPLES - _count + i) % UNIVERSALUI_HEAP_SAMPLES];
+    }
+
+    /** Prints latest sample, for use in HTML. */
+    size_t printLatest(Print &out) const
+    {
+        if (0 == _count)
+            return 0;
+        const HeapSample &s = getSample(_count - 1);
+        size_t len = out.print(F("heap: free="));
+        len += out.print(s.freeHeap);
+        len += out.print(F(" maxBlock="));
+        len += out.print(s.maxFreeBlock);
+        len += out.print(F(" fragmentation="));
+        len += out.print(s.fragmentation);
+        len += out.print(F("&#37; minFreeStack="));
+        len += out.print(s.minFreeStack);
+        return len;
+    }
+
+    /** Prints all samples as CSV with header line, oldest first. */
+    size_t printCsv(Print &out) const
+    {
+        size_t len = out.print(F("millis,freeHeap,maxFreeBlock,fragmentation,minFreeStack\n"));
+        for (uint8_t i = 0; i < _count; ++i)
+        {
+            const HeapSample &s = getSample(i);
+            len += out.print(s.millis);
+            len += out.print(',');
+            len += out.print(s.freeHeap);
+            len += out.print(',');
+            len += out.print(s.maxFreeBlock);
+            len += out.print(',');
+            len += out.print(s.fragmentation);
+            len += out.print(',');
+            len += out.print(s.minFreeStack);
+            len += out.print('\n');
+        }
+        return len;
+    }
+};
+#endif
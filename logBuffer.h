@@ -14,7 +14,7 @@ You should have received a copy of the GNU General Public License along with thi
 #ifndef LOG_BUFFER_H
 #define LOG_BUFFER_H
 
-#include "universalUIsettings.h"
+#include "perfProfiler.h"
 
 #ifdef VERBOSE_DEBUG_LOGBUFFER
 #define LOGBUFFER_DEBUG(M, V) (Serial << M << V);
@@ -28,18 +28,25 @@ You should have received a copy of the GNU General Public License along with thi
  * Collects all data into buf.
  * 
  * Implemented as circular ring buffer:
- * if buf size is reached, first data logged will be overwritten, preceded by "[...]".
+ * if buf size is reached, first data logged will be overwritten; reads of a clipped log are preceded by "[...] ".
  * 
  * To determine max size, use the output of the compiler (memory used).
  * If not fitting, you will get errors like "section ... will not fit in region ..." from the linker.
  * TOCHECK: beware that some memory areas has special purpose, hopefully the compiler will warn?
  * 
- * define-Parameters:
+ * Optionally, content can be structured with binary log records (see writeRecord()), these are formatted only at read time.
+ * 
+ * define-Parameters, by earlier #define's (universalUI.h includes universalUIsettings.h before):
  * <li><code>#define LOGBUF_LENGTH 51200</code> - default is 16 characters (for testing purpose)</li>
  * <li><code>COPY_TO_SERIAL</code> - if defined, logged data will be mirrored via Serial.print</li>
+ * <li><code>COPY_TO_SERIAL_NONBLOCKING</code> - if defined, logged data is not printed while appending, but read from the ring by <code>UniversalUI::handle()</code> (see readFollow())</li>
+ * <li><code>LOGBUFFER_LOCKFREE</code> - if defined, appending and reading is done without critical section (ESP32/ESP8266 only).
+ * Then only one thread may log (the arduino loop), readers detect if they got overrun by the writer and resync.</li>
  */
 
 // need this (at least on ESP32) since arduino loop and webserver might run on different cores/threads
+// same as in appendBuffer.h, whichever is included first defines it
+#ifndef MUTEX_LOCK
 #if defined(ESP32)
 #define MUTEX_LOCK portENTER_CRITICAL(&logBuffer_mutex);
 #define MUTEX_UNLOCK portEXIT_CRITICAL(&logBuffer_mutex);
@@ -48,81 +55,398 @@ static portMUX_TYPE logBuffer_mutex = portMUX_INITIALIZER_UNLOCKED;
 #define MUTEX_LOCK noInterrupts(); // we must not implement waiting for a mutex here since in ISR wie can't wait!
 #define MUTEX_UNLOCK interrupts(); // we can only disable interrupts for the critical section of updating the buffer
 #endif
-#if !defined(ESP32) && !defined(ESP8266)
+#endif
+#if defined(COPY_TO_SERIAL) && defined(COPY_TO_SERIAL_NONBLOCKING)
+#error "define either COPY_TO_SERIAL (printed while appending) or COPY_TO_SERIAL_NONBLOCKING (printed by UniversalUI::handle())"
+#endif
+#if !defined(ESP32) && !defined(ESP8266) && !defined(RESPONSE_TRY_AGAIN)
 #define RESPONSE_TRY_AGAIN 0xFFFF // is defined by AsyncWebServer
 #endif
 
+// single producer ring: writer publishes _head after writing, readers validate their copy against _reserve
+#ifdef LOGBUFFER_LOCKFREE
+#if !defined(ESP32) && !defined(ESP8266)
+#error "LOGBUFFER_LOCKFREE requires atomic access to 32bit values, supported on ESP32/ESP8266 only"
+#endif
+#define LOGBUFFER_LOCK ;
+#define LOGBUFFER_UNLOCK ;
+#else
+#define LOGBUFFER_LOCK MUTEX_LOCK PERF_LOCK_BEGIN
+#define LOGBUFFER_UNLOCK PERF_LOCK_END(PERF_LOGBUFFER_LOCK) MUTEX_UNLOCK
+#endif
+#if defined(ESP32) || defined(ESP8266)
+#define LOGBUFFER_LOAD(V) __atomic_load_n(&(V), __ATOMIC_ACQUIRE)
+#define LOGBUFFER_STORE(V, X) __atomic_store_n(&(V), (X), __ATOMIC_RELEASE)
+#define LOGBUFFER_FENCE __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#else
+#define LOGBUFFER_LOAD(V) (V)
+#define LOGBUFFER_STORE(V, X) (V) = (X)
+#define LOGBUFFER_FENCE __asm__ __volatile__("" ::: "memory");
+#endif
+#ifndef LOGBUFFER_READ_RETRIES
+#define LOGBUFFER_READ_RETRIES 3 // how often a reader retries a chunk after being overrun by the writer
+#endif
+
+// binary log records: marker byte, followed by header bytes with 7 bits each (highest bit set), followed by the text payload
+#define LOGBUFFER_RECORD_MARKER '\x01'
+#define LOGBUFFER_RECORD_LEN 12      // marker, level, 5 bytes for millis, 5 bytes for epoch
+#define LOGBUFFER_RECORD_TEXT_LEN 24 // maximum length of a formatted record header
+
+/** Header of a log record, stored in binary form and formatted at read time. */
+struct LogRecord
+{
+    uint32_t millis;
+    uint32_t epoch; // 0 if no time available
+    uint8_t level;
+};
+
+/**
+ * Formats the given log record into text.
+ * @return length of text, at most maxTextLen-1
+ */
+typedef size_t (*LogRecordFormatter)(const LogRecord &record, char *text, size_t maxTextLen);
+
+/**
+ * Request-specific state of a chunked read with <code>LogBuffer::getLog(uint8_t *, size_t, size_t, LogReadState &)</code>.
+ * It is initialized at first call (index==0), content is managed by LogBuffer - except rawPercent, which is set by the caller.
+ */
+struct LogReadState
+{
+    size_t seq;                                // sequence number of next byte to read from ring buffer
+    size_t end;                                // sequence number to stop reading at, is the append position at start of read
+    uint8_t markerPos;                         // number of characters of clipped marker already delivered
+    bool pendingPercent;                       // second '%' of an encoded "%%" still to deliver
+    bool rawPercent = false;                   // if '%' should not be encoded, e.g. if output is not processed by AsyncWebServer's template processor
+    uint8_t recordTextLen;                     // length of formatted record header
+    uint8_t recordTextPos;                     // number of characters of formatted record header already delivered
+    char recordText[LOGBUFFER_RECORD_TEXT_LEN]; // formatted record header
+};
+
+#ifndef LOGBUFFER_MERGE_CHANNELS
+#define LOGBUFFER_MERGE_CHANNELS 2 // maximum number of logs merged by readMergedLog()
+#endif
+
+#define LOGBUFFER_PERSISTENCE_MAGIC 0x4C6F6742 // "LogB"
+
+/**
+ * Header to continue the log after a reset, to be placed together with the ring memory in memory not initialized at boot.
+ * check is an XOR of the other values, so a header partially written at the time of a crash is detected. The ring content is not validated.
+ */
+struct LogBufferPersistence
+{
+    uint32_t magic;
+    uint32_t check;
+    size_t head;
+    size_t appendIndex;
+};
+
 class LogBuffer : public Print
 {
 private:
-    size_t _bufSize;
+    size_t _bufSize;  // size of ring, one slot of it is always occupied by the terminating '\0'
+    size_t _seqLimit; // sequence numbers are wrapped before reaching this value, is a multiple of _bufSize
     bool _encodePercent;
     char *_buffer;
-    size_t _appendIndex = 0; // where to append next logged character
-    bool _clipped = false;
+    bool _ownsBuffer = false;
+    LogBufferPersistence *_persistence = nullptr;
+    bool _restored = false;
+    LogRecordFormatter _recordFormatter = nullptr;
+    size_t _appendIndex = 0;      // where to append next logged character, only used by the writer
+    volatile size_t _head = 0;    // sequence number of next character to append, that is the number of characters logged
+    volatile size_t _reserve = 0; // sequence number up to which the writer might currently modify the ring
     char clippedMarker[7] = {'[', '.', '.', '.', ']', ' ', '\0'};
-    void bufEnd()
+
+    /** @return number of characters the ring can hold */
+    size_t window() const { return _bufSize - 1; }
+    bool isClipped(const size_t head) const { return head > window(); }
+    /** @return sequence number of the oldest character still available */
+    size_t oldestSeq(const size_t head) const { return isClipped(head) ? head - window() : 0; }
+
+    /** @return sequence number of the oldest character to start reading with, skipping remains of a record header (or of a multibyte character) if clipped */
+    size_t startSeq(const size_t head) const
+    {
+        return alignSeq(oldestSeq(head), head);
+    }
+    /** @return sequence number to continue an overrun read with: start of the oldest complete line before end, if there is one */
+    size_t resyncSeq(const size_t head, const size_t end) const
     {
-        size_t p = _appendIndex;
-        _buffer[incWithRollover(p)] = '\0';
-        if (_clipped)
+        if ((head - end) > window())
+            return end; // unread content is lost completely
+        const size_t seq = startSeq(head);
+        for (size_t i = seq; i != end; ++i)
         {
-            for (int i = 0; clippedMarker[i] != '\0'; ++i)
-            {
-                _buffer[incWithRollover(p)] = clippedMarker[i];
-            }
+            if ('\n' == _buffer[i % _bufSize])
+                return i + 1; // record headers don't contain '\n', so a record or text starts here
         }
+        return seq;
+    }
+    /**
+     * @return given seq, skipping remains of a record header (or of a multibyte character), that is at most LOGBUFFER_RECORD_LEN - 1 bytes with bit 7 set.
+     * Note: only for seq at an arbitrary position like the oldest character, since it can't distinguish them from UTF-8 text.
+     */
+    size_t alignSeq(size_t seq, const size_t head) const
+    {
+        for (uint8_t skipped = 1; (skipped < LOGBUFFER_RECORD_LEN) && (seq != head) && (0x80 & _buffer[seq % _bufSize]); ++skipped)
+            ++seq;
+        return seq;
     }
 
-    /** Increment given argument by one with handling rollover, returning the original value (next index to write to). */
-    const word incWithRollover(size_t &idx)
+    /** Announces the given number of characters to be appended, must be followed by appendChar() and endAppend(). */
+    void beginAppend(const size_t len)
+    {
+        LOGBUFFER_STORE(_reserve, _head + len);
+        LOGBUFFER_FENCE; // readers must see the reservation before the ring content changes
+    }
+    void appendChar(const char c)
+    {
+        _buffer[_appendIndex] = c;
+        if (++_appendIndex >= _bufSize)
+            _appendIndex = 0;
+    }
+    /** Appends with at most two memcpy around the wrap point. If data is larger than the ring, only its tail is kept. */
+    void appendChars(const uint8_t *src, size_t len)
+    {
+        if (len > _bufSize)
+        {
+            _appendIndex = (_appendIndex + len - _bufSize) % _bufSize;
+            src += len - _bufSize;
+            len = _bufSize;
+        }
+        const size_t firstLen = ((_bufSize - _appendIndex) < len) ? (_bufSize - _appendIndex) : len;
+        memcpy(&_buffer[_appendIndex], src, firstLen);
+        memcpy(&_buffer[0], &src[firstLen], len - firstLen);
+        _appendIndex += len;
+        if (_appendIndex >= _bufSize)
+            _appendIndex -= _bufSize;
+    }
+    /** Terminates the appended characters and publishes them to readers. */
+    void endAppend(const size_t len)
+    {
+        _buffer[_appendIndex] = '\0';
+        size_t head = _head + len;
+        if (head >= _seqLimit)
+        {
+            head -= _seqLimit - _bufSize; // keeps position in ring and the clipped state
+            LOGBUFFER_STORE(_reserve, head);
+        }
+        LOGBUFFER_STORE(_head, head);
+        if (nullptr != _persistence)
+            persist(head);
+    }
+
+    uint32_t persistenceCheck(const size_t head) const
+    {
+        return LOGBUFFER_PERSISTENCE_MAGIC ^ _bufSize ^ head ^ (_appendIndex << 16);
+    }
+    void persist(const size_t head)
+    {
+        _persistence->head = head;
+        _persistence->appendIndex = _appendIndex;
+        _persistence->check = persistenceCheck(head);
+        _persistence->magic = LOGBUFFER_PERSISTENCE_MAGIC;
+    }
+    /** @return true if the content described by _persistence is consistent and can be continued */
+    bool restore()
     {
-        const word x = idx;
-        if (++idx >= _bufSize)
+        const size_t head = _persistence->head;
+        _appendIndex = _persistence->appendIndex;
+        if ((LOGBUFFER_PERSISTENCE_MAGIC != _persistence->magic) || (persistenceCheck(head) != _persistence->check) || (head >= _seqLimit) || ((head % _bufSize) != _appendIndex) || ('\0' != _buffer[_appendIndex]) || ('\0' != _buffer[_bufSize]))
         {
-            idx = 0;
-            _clipped = true;
+            _appendIndex = 0;
+            return false;
         }
-        return x;
+        _head = head;
+        _reserve = head;
+        return true;
+    }
+
+    void append(const uint8_t *buf, const size_t size)
+    {
+        LOGBUFFER_LOCK;
+        beginAppend(size);
+        appendChars(buf, size);
+        endAppend(size);
+        LOGBUFFER_UNLOCK;
+    }
+    /** Appends both parts at once, so no other writer can append in between. */
+    void append(const uint8_t *first, const size_t firstSize, const uint8_t *second, const size_t secondSize)
+    {
+        LOGBUFFER_LOCK;
+        beginAppend(firstSize + secondSize);
+        appendChars(first, firstSize);
+        appendChars(second, secondSize);
+        endAppend(firstSize + secondSize);
+        LOGBUFFER_UNLOCK;
     }
 
-    /** Copies content from sourceBuf[startIndex] to targetBuf, taking care of available data lengths */
-    size_t copyLog(uint8_t *targetBuf, size_t maxTargetLen, size_t startIndex, char *sourceBuf, size_t availableLogLen)
+    static void encodeRecordValue(uint8_t *target, uint32_t value)
     {
-        if (0 == maxTargetLen && availableLogLen > 0)
+        for (uint8_t i = 0; i < 5; ++i, value >>= 7)
         {
-            LOGBUFFER_DEBUGN("      logBuffer.copy: try again, availableLogLen=", availableLogLen)
-            return RESPONSE_TRY_AGAIN;
+            target[i] = 0x80 | (value & 0x7F);
         }
-        const size_t copyLen = ((availableLogLen - startIndex) < maxTargetLen) ? (availableLogLen - startIndex) : maxTargetLen;
-        LOGBUFFER_DEBUG("      logBuffer.copy: copyLen=", copyLen)
-        LOGBUFFER_DEBUG(", startIndex=", startIndex)
-        LOGBUFFER_DEBUGN(", bufStartOfs=", (sourceBuf - &_buffer[0]))
-#ifdef VERBOSE_DEBUG
-        if (0 == startIndex)
+    }
+    /** Fills header with the binary form of record, and mirrors it formatted with COPY_TO_SERIAL. */
+    void encodeRecord(uint8_t *header, const LogRecord &record) const
+    {
+        header[0] = LOGBUFFER_RECORD_MARKER;
+        header[1] = 0x80 | record.level;
+        encodeRecordValue(&header[2], record.millis);
+        encodeRecordValue(&header[7], record.epoch);
+#ifdef COPY_TO_SERIAL
+        if (nullptr != _recordFormatter)
         {
-            Serial.print("      logBuffer.copy: 1>");
-            for (size_t i = 0; i < copyLen; ++i)
-            {
-                Serial.print((char)sourceBuf[startIndex + i]);
-            }
-            Serial.println("<1");
+            char text[LOGBUFFER_RECORD_TEXT_LEN];
+            Serial.write(text, _recordFormatter(record, text, LOGBUFFER_RECORD_TEXT_LEN));
         }
 #endif
-        memcpy(targetBuf, &sourceBuf[startIndex], copyLen);
+    }
+    static uint32_t decodeRecordValue(const uint8_t *source)
+    {
+        uint32_t value = 0;
+        for (uint8_t i = 5; i > 0; --i)
+        {
+            value = (value << 7) | (source[i - 1] & 0x7F);
+        }
+        return value;
+    }
+
+    /** @return record header starting at ring index */
+    LogRecord decodeRecord(size_t index) const
+    {
+        uint8_t header[LOGBUFFER_RECORD_LEN];
+        for (uint8_t i = 0; i < LOGBUFFER_RECORD_LEN; ++i)
+        {
+            header[i] = _buffer[index];
+            if (++index >= _bufSize)
+                index = 0;
+        }
+        return {decodeRecordValue(&header[2]), decodeRecordValue(&header[7]), (uint8_t)(header[1] & 0x7F)};
+    }
+
+    /** Formats the record header starting at ring index into state.recordText. */
+    uint8_t formatRecord(size_t index, LogReadState &state)
+    {
+        if (nullptr == _recordFormatter)
+            return 0;
+        return _recordFormatter(decodeRecord(index), state.recordText, LOGBUFFER_RECORD_TEXT_LEN);
+    }
+
+    /** Delivers what has been left over from the previous call: rest of formatted record header, or second '%'; then the clipped marker if due */
+    size_t copyPending(uint8_t *targetBuf, const size_t maxTargetLen, LogReadState &state)
+    {
+        size_t filled = 0;
+        while ((state.recordTextPos < state.recordTextLen) && (filled < maxTargetLen))
+        {
+            targetBuf[filled++] = state.recordText[state.recordTextPos++];
+        }
+        if (state.pendingPercent && (filled < maxTargetLen))
+        {
+            targetBuf[filled++] = '%';
+            state.pendingPercent = false;
+        }
+        while (('\0' != clippedMarker[state.markerPos]) && (filled < maxTargetLen))
+        {
+            targetBuf[filled++] = clippedMarker[state.markerPos++];
+        }
+        return filled;
+    }
 
-#ifdef VERBOSE_DEBUG
-        if (0 == startIndex)
+    /**
+     * Copies ring content starting at state.seq to targetBuf, taking care of available data lengths.
+     * If encodePercent is set, a '%' is delivered as "%%". Log records are delivered formatted by the record formatter.
+     * What has been split by maxTargetLen is completed by the next call.
+     * 
+     * The copy is validated against the reservation of the writer: if the writer overran the reader, it is resynced to the oldest available line,
+     * marked by "[...] " in the output. So each delivered part of the log is consistent, even if the read is split into several chunks.
+     */
+    size_t copyLog(uint8_t *targetBuf, const size_t maxTargetLen, LogReadState &state)
+    {
+        size_t pendingLen = copyPending(targetBuf, maxTargetLen, state);
+        for (uint8_t tries = LOGBUFFER_READ_RETRIES; tries > 0; --tries)
         {
-            Serial.print("      logBuffer.copy: 2>");
-            for (size_t i = 0; i < copyLen; ++i)
+            const size_t head = LOGBUFFER_LOAD(_head);
+            if ((state.seq != state.end) && ((head - state.seq) > window()))
+            { // reader has been overrun (or buffer cleared) since last call
+                LOGBUFFER_DEBUGN("      logBuffer.copy: resync, overrun at seq=", state.seq)
+                state.seq = resyncSeq(head, state.end);
+                state.markerPos = 0;
+                pendingLen += copyPending(&targetBuf[pendingLen], maxTargetLen - pendingLen, state);
+            }
+            const size_t stop = ((state.end - state.seq) <= (head - state.seq)) ? state.end : head;
+            size_t seq = state.seq;
+            size_t copyIndex = seq % _bufSize;
+            size_t filled = pendingLen;
+            bool pendingPercent = state.pendingPercent; // still set if not completely delivered by copyPending()
+            uint8_t recordTextLen = state.recordTextLen;
+            uint8_t recordTextPos = state.recordTextPos;
+            LOGBUFFER_DEBUG("      logBuffer.copy: available=", (stop - seq))
+            LOGBUFFER_DEBUGN(", startIndex=", copyIndex)
+            while ((filled < maxTargetLen) && (seq != stop))
             {
-                Serial.print((char)targetBuf[i]);
+                if (LOGBUFFER_RECORD_MARKER == _buffer[copyIndex])
+                {
+                    if ((stop - seq) < LOGBUFFER_RECORD_LEN)
+                    { // incomplete record header, can only happen if overrun
+                        seq = stop;
+                        break;
+                    }
+                    recordTextLen = formatRecord(copyIndex, state);
+                    recordTextPos = 0;
+                    while ((recordTextPos < recordTextLen) && (filled < maxTargetLen))
+                    {
+                        targetBuf[filled++] = state.recordText[recordTextPos++];
+                    }
+                    seq += LOGBUFFER_RECORD_LEN;
+                    copyIndex += LOGBUFFER_RECORD_LEN;
+                    if (copyIndex >= _bufSize)
+                        copyIndex -= _bufSize;
+                    continue;
+                }
+                size_t len = stop - seq;
+                if ((_bufSize - copyIndex) < len)
+                    len = _bufSize - copyIndex;
+                if ((maxTargetLen - filled) < len)
+                    len = maxTargetLen - filled;
+                const char *source = &_buffer[copyIndex];
+                const char *marker = (const char *)memchr(source, LOGBUFFER_RECORD_MARKER, len);
+                if (nullptr != marker)
+                    len = marker - source;
+                if (_encodePercent && !state.rawPercent)
+                {
+                    const char *percent = (const char *)memchr(source, '%', len);
+                    if (nullptr != percent)
+                    {
+                        len = percent - source + 1;
+                        pendingPercent = true;
+                    }
+                }
+                memcpy(&targetBuf[filled], source, len);
+                filled += len;
+                seq += len;
+                copyIndex += len;
+                if (copyIndex >= _bufSize)
+                    copyIndex = 0;
+                if (pendingPercent && (filled < maxTargetLen))
+                {
+                    targetBuf[filled++] = '%';
+                    pendingPercent = false;
+                }
+            }
+            LOGBUFFER_FENCE;
+            if ((seq == state.seq) || ((LOGBUFFER_LOAD(_reserve) - state.seq) <= window()))
+            { // nothing copied (like at the end of a complete read), or not overwritten meanwhile
+                state.seq = seq;
+                state.pendingPercent = pendingPercent;
+                state.recordTextLen = recordTextLen;
+                state.recordTextPos = recordTextPos;
+                return filled;
             }
-            Serial.println("<2 ");
         }
-#endif
-        return copyLen;
+        // writer is too fast: continue with the oldest complete line, marked by "[...] " (so the response does not end here)
+        state.seq = resyncSeq(LOGBUFFER_LOAD(_head), state.end);
+        state.markerPos = 0;
+        return pendingLen + copyPending(&targetBuf[pendingLen], maxTargetLen - pendingLen, state);
     }
 
 public:
@@ -132,160 +456,421 @@ public:
      */
     LogBuffer(const size_t capacity, char *buffer, const bool encodePercent = false) : _bufSize(capacity - 1), _encodePercent(encodePercent), _buffer(buffer)
     {
+        _seqLimit = (((size_t)-1) / _bufSize - 1) * _bufSize;
         _buffer[_bufSize] = '\0';
         _buffer[0] = '\0';
     }
 
+    /**
+     * Constructor with externally supplied memory surviving a reset (e.g. section ".noinit"), together with persistence.
+     * If persistence describes a consistent content of buffer, the log is continued (see isRestored()), otherwise started empty.
+     */
+    LogBuffer(const size_t capacity, char *buffer, LogBufferPersistence &persistence, const bool encodePercent = false) : _bufSize(capacity - 1), _encodePercent(encodePercent), _buffer(buffer), _persistence(&persistence)
+    {
+        _seqLimit = (((size_t)-1) / _bufSize - 1) * _bufSize;
+        _restored = restore();
+        if (!_restored)
+        {
+            _buffer[_bufSize] = '\0';
+            _buffer[0] = '\0';
+            persist(0);
+        }
+    }
+
     /**
      * Use this constructor at your own risk: it uses dynamically allocated memory.
      * If not enough memory is available, ESP8266 will reboot with `rst cause:1, boot mode:(3,0)`.
      *  
      * Note: supports fix for https://github.com/me-no-dev/ESPAsyncWebServer/issues/333: '%' in template result is evaluated as template again
-     * @param encodePercent true if '%' in content should be stored as "%%"
+     * @param encodePercent true if '%' in content should be delivered as "%%" by getLog(), content itself is stored unmodified
      */
-    LogBuffer(const size_t capacity, const bool encodePercent = false) : _bufSize(capacity), _encodePercent(encodePercent), _buffer(new char[_bufSize + 1])
+    LogBuffer(const size_t capacity, const bool encodePercent = false) : _bufSize(capacity), _encodePercent(encodePercent), _buffer(new char[_bufSize + 1]), _ownsBuffer(true)
     {
+        _seqLimit = (((size_t)-1) / _bufSize - 1) * _bufSize;
         _buffer[_bufSize] = '\0';
         _buffer[0] = '\0';
     }
     ~LogBuffer()
     {
-        delete _buffer;
+        if (_ownsBuffer)
+            delete[] _buffer;
     }
 
+    /** @return true if content from before the last reset was continued, see LogBufferPersistence */
+    bool isRestored() const { return _restored; }
+
     virtual size_t write(uint8_t c)
     {
 #ifdef COPY_TO_SERIAL
         Serial.print((char)c);
 #endif
-        MUTEX_LOCK;
-        _buffer[incWithRollover(_appendIndex)] = c;
-        if (_encodePercent && ('%' == c))
-        {
-            _buffer[incWithRollover(_appendIndex)] = c;
-        }
-        MUTEX_UNLOCK;
+        LOGBUFFER_LOCK;
+        beginAppend(1);
+        appendChar(c);
+        endAppend(1);
+        LOGBUFFER_UNLOCK;
         return 1;
     }
 
+    virtual size_t write(const uint8_t *buf, size_t size)
+    {
+#ifdef COPY_TO_SERIAL
+        Serial.write(buf, size);
+#endif
+        append(buf, size);
+        return size;
+    }
+
     size_t write(const char *msg)
+    {
+        return write((const uint8_t *)msg, strlen(msg));
+    }
+
+    /**
+     * Sets the formatter to convert log records into text at read time.
+     * Without formatter, log records are delivered without header.
+     */
+    void setRecordFormatter(LogRecordFormatter formatter)
+    {
+        _recordFormatter = formatter;
+    }
+
+    /**
+     * Appends a log record header in binary form (12 bytes), subsequently written content is its payload.
+     * The header is formatted only when read by the chunked getLog().
+     */
+    void writeRecord(const LogRecord &record)
+    {
+        uint8_t header[LOGBUFFER_RECORD_LEN];
+        encodeRecord(header, record);
+        append(header, LOGBUFFER_RECORD_LEN);
+    }
+
+    /**
+     * Appends a complete log entry, that is prefix (like a formatted timestamp) and text, with a single append.
+     * So entries of several tasks don't interleave, other than by a chain of write() calls.
+     */
+    void writeEntry(const char *prefix, const size_t prefixLen, const char *text, const size_t textLen)
     {
 #ifdef COPY_TO_SERIAL
-        Serial.print(msg);
+        Serial.write(prefix, prefixLen);
+        Serial.write(text, textLen);
 #endif
-        word i = 0;
-        MUTEX_LOCK;
-        while (msg[i] != '\0')
-        {
-            _buffer[incWithRollover(_appendIndex)] = msg[i];
-            if (_encodePercent && ('%' == msg[i]))
-            {
-                _buffer[incWithRollover(_appendIndex)] = msg[i];
-            }
-            ++i;
-        }
-        bufEnd();
-        MUTEX_UNLOCK;
-        return i;
+        append((const uint8_t *)prefix, prefixLen, (const uint8_t *)text, textLen);
+    }
+    /** Same as above, with the header of a log record (see writeRecord()) as prefix. */
+    void writeEntry(const LogRecord &record, const char *text, const size_t textLen)
+    {
+        uint8_t header[LOGBUFFER_RECORD_LEN];
+        encodeRecord(header, record);
+#ifdef COPY_TO_SERIAL
+        Serial.write(text, textLen);
+#endif
+        append(header, LOGBUFFER_RECORD_LEN, (const uint8_t *)text, textLen);
     }
 
     /** Reset the log buffer to initial = empty state. */
     void clear()
     {
-        MUTEX_LOCK;
-        _clipped = false;
+        LOGBUFFER_LOCK;
         _appendIndex = 0;
         _buffer[_bufSize] = '\0';
         _buffer[0] = '\0';
-        MUTEX_UNLOCK;
+        LOGBUFFER_STORE(_reserve, 0);
+        LOGBUFFER_STORE(_head, 0);
+        if (nullptr != _persistence)
+            persist(0);
+        LOGBUFFER_UNLOCK;
     }
 
-    /** Get the log buffer content.
-     * Must be called twice, first with argument <code>0</code>, 2nd with argument <code>1</code>.
+    /**
+     * Copies the log buffer content into buf, with terminating '\0', preceded by "[...] " if clipped.
+     * Replaces the former part API getLog(0)/getLog(1), which kept a copy of the size of the ring on heap.
+     * Like the chunked getLog(), log records are delivered formatted and '%' is delivered as "%%" if encodePercent is set. Prefer the chunked getLog(), which needs no copy.
+     *
+     * @param size of buf, including the terminator
+     * @return length of the complete content, like snprintf(): if it is size or more, buf holds only the oldest size-1 characters
      */
-    const char *getLog(const byte part) const
+    size_t getLog(char *buf, const size_t size)
     {
-        const char *result;
-        MUTEX_LOCK;
-        ; // note: we are not in the arduino thread here
-        if (0 == part)
-        {
-            result = _clipped ? &_buffer[_appendIndex + 1] : &_buffer[0];
-        }
-        else if (1 == part && _clipped)
+        LogReadState state;
+        beginRead(state);
+        size_t len = 0;
+        size_t filled;
+        while (((len + 1) < size) && (0 != (filled = readLog((uint8_t *)&buf[len], size - len - 1, state))))
+            len += filled;
+        if (0 != size)
+            buf[len] = '\0';
+        uint8_t rest[32];
+        while (0 != (filled = readLog(rest, sizeof(rest), state))) // content not fitting, only counted
+            len += filled;
+        return len;
+    }
+
+    /**
+     * @return sequence number of the next character to be logged, that is the number of characters logged so far.
+     * It wraps (to a multiple of the ring size) only after about 4GB are logged.
+     */
+    size_t getSeq() const
+    {
+        return LOGBUFFER_LOAD(_head);
+    }
+
+    /**
+     * Starts a chunked read of the content logged after sequence number since, continued by readLog().
+     * If since is not available anymore (or invalid), the read starts with the oldest content, preceded by "[...] " if clipped.
+     * 
+     * @param state required request-specific state-memory
+     * @param since sequence number as returned by a previous beginRead() or getSeq(), 0 reads all content
+     * @return sequence number at the end of this read, to be used as since for the next read
+     */
+    size_t beginRead(LogReadState &state, const size_t since = 0)
+    {
+        LOGBUFFER_LOCK; // note: we are not in the arduino thread here
+        const size_t head = LOGBUFFER_LOAD(_head);
+        const bool available = (head - since) <= window();
+        state.end = head;
+        state.seq = available ? since : startSeq(head); // since is at the end of a previous write, so it needs no alignment
+        state.markerPos = (!available && isClipped(head)) ? 0 : strlen(clippedMarker);
+        state.pendingPercent = false;
+        state.recordTextLen = 0;
+        state.recordTextPos = 0;
+        LOGBUFFER_DEBUG("initialized read at seq=", state.seq)
+        LOGBUFFER_DEBUGN(" end=", state.end);
+        LOGBUFFER_UNLOCK;
+        return head;
+    }
+
+    /**
+     * Fills the given buffer with data of the read started with beginRead().
+     * Delivers the content logged till beginRead(), further appended content is not included.
+     * If the writer overran the reader between calls, reading continues with the oldest available content.
+     * 
+     * @param targetBuf buffer to fill with data
+     * @param maxLen maximum number of bytes to fill into buf
+     * @param state request-specific state-memory, as initialized by beginRead()
+     * @return number of bytes filled into buf, or 0 if there is no more data available, or RESPONSE_TRY_AGAIN if maxLen is 0 and more content available
+     */
+    size_t readLog(uint8_t *targetBuf, const size_t maxLen, LogReadState &state)
+    {
+        size_t result = 0;
+        LOGBUFFER_LOCK; // note: we are not in the arduino thread here
+        if (0 == maxLen)
         {
-            result = &_buffer[0];
+            result = ((state.markerPos < strlen(clippedMarker)) || state.pendingPercent || (state.recordTextPos < state.recordTextLen) || (state.seq != state.end)) ? RESPONSE_TRY_AGAIN : 0;
         }
         else
         {
-            result = &clippedMarker[strlen(clippedMarker)]; // empty string
+            result = copyLog(targetBuf, maxLen, state);
         }
-        MUTEX_UNLOCK;
+        LOGBUFFER_UNLOCK;
         return result;
     }
 
     /**
-     * Fills the given buffer with data from the log buffer content.
-     * This method also takes care of rolling buffer overflow.
-     * 
-     * TODO If buffer rollover-position has advanced over index since last read, the new content is filled, that could lead to scrambled result?
-     * 
-     * @param targetBuf buffer to fill with data
-     * @param maxLen maximum number of bytes to fill into buf
-     * @param index logical start position of log buffer
-     * @param bufferRollIndex required request-specific state-memory, is initialized at first call (index==0)
-     * @return number of bytes filled into buf, or 0 if there is no more data available, or RESPONSE_TRY_AGAIN if maxLen is 0 and more content available
+     * Determines the next entry of a read, for merging several logs by time (see readMergedLog()).
+     * Resyncs the read if it has been overrun.
+     *
+     * @param record header of the log record at the read position; level is 0 if the read position is not at a record, like content before the first record
+     * @param nextSeq sequence number of the following record, or end of the read
+     * @return false if the read is complete
      */
-    size_t getLog(uint8_t *targetBuf, size_t maxLen, size_t index, size_t &bufferRollIndex)
+    bool peekRecord(LogReadState &state, LogRecord &record, size_t &nextSeq)
     {
-        size_t result;
-        MUTEX_LOCK; // note: we are not in the arduino thread here
-        if (0 == index || !_clipped)
+        LOGBUFFER_LOCK; // note: we are not in the arduino thread here
+        const size_t head = LOGBUFFER_LOAD(_head);
+        if ((state.seq != state.end) && ((head - state.seq) > window()))
         {
-            bufferRollIndex = _appendIndex;
-            LOGBUFFER_DEBUG("initialized bufferRollIndex=", bufferRollIndex)
-            LOGBUFFER_DEBUGN(" appendIndex=", _appendIndex);
+            state.seq = resyncSeq(head, state.end);
+            state.markerPos = 0;
         }
-        if (_clipped)
+        size_t seq = state.seq;
+        record.level = 0;
+        if ((seq != state.end) && (LOGBUFFER_RECORD_MARKER == _buffer[seq % _bufSize]))
         {
-            if (index >= _bufSize)
-            {
-                // buffer completely read
-                result = 0;
-            }
-            else if ((index + 1) < (_bufSize - _appendIndex))
+            if ((state.end - seq) >= LOGBUFFER_RECORD_LEN)
             {
-                // part 0: appendIndex+1 .. LOGBUF_LENGTH;  length = (LOGBUF_LENGTH-appendIndex-1)
-                LOGBUFFER_DEBUG("    part 0: maxLen=", maxLen)
-                LOGBUFFER_DEBUG(", index=", index)
-                LOGBUFFER_DEBUGN(", bufferRollIndex=", bufferRollIndex)
-                result = copyLog(targetBuf, maxLen, index, &_buffer[bufferRollIndex + 1], (_bufSize - bufferRollIndex - 1));
+                record = decodeRecord(seq % _bufSize);
+                seq += LOGBUFFER_RECORD_LEN;
             }
             else
-            {
-                LOGBUFFER_DEBUG("    part 1: maxLen=", maxLen)
-                LOGBUFFER_DEBUG(", index=", index)
-                LOGBUFFER_DEBUGN(", bufferRollIndex=", bufferRollIndex);
-                // part 1: 0 .. appendIndex-1;  length = appendIndex
-                result = copyLog(targetBuf, maxLen, index - (_bufSize - bufferRollIndex - 1), &_buffer[0], bufferRollIndex);
-            }
+                seq = state.end; // incomplete record header, skipped by copyLog()
         }
-        else
-        {
-            if (index < _appendIndex)
+        while ((seq != state.end) && (LOGBUFFER_RECORD_MARKER != _buffer[seq % _bufSize]))
+            ++seq;
+        nextSeq = seq;
+        const bool available = (state.seq != state.end) || (state.markerPos < strlen(clippedMarker)) || state.pendingPercent || (state.recordTextPos < state.recordTextLen);
+        LOGBUFFER_UNLOCK;
+        return available;
+    }
+
+    /**
+     * Same as readLog(), but follows the log: if the read is complete, it continues with the content logged meanwhile.
+     * For mirroring the log, e.g. to a file or to Serial. If the writer overran the reader, reading continues with "[...] ".
+     * 
+     * @param state as initialized by beginRead(), is kept for the next content logged
+     * @return number of bytes filled into buf, or 0 if all content logged so far is delivered
+     */
+    size_t readFollow(uint8_t *targetBuf, const size_t maxLen, LogReadState &state)
+    {
+        size_t len = readLog(targetBuf, maxLen, state);
+        if ((0 == len) && (state.end != getSeq()))
+        { // continue the cursor, an overrun is resynced by copyLog()
+            LOGBUFFER_LOCK;
+            state.end = LOGBUFFER_LOAD(_head);
+            LOGBUFFER_UNLOCK;
+            len = readLog(targetBuf, maxLen, state);
+        }
+        return len;
+    }
+
+    /**
+     * Fills the given buffer with data from the log buffer content.
+     * This method also takes care of rolling buffer overflow: if log has been clipped, output starts with "[...] ".
+     * See beginRead() and readLog().
+     * 
+     * @param targetBuf buffer to fill with data
+     * @param maxLen maximum number of bytes to fill into buf
+     * @param index logical start position of log buffer, value 0 starts a new read
+     * @param state required request-specific state-memory, is initialized at first call (index==0)
+     * @return number of bytes filled into buf, or 0 if there is no more data available, or RESPONSE_TRY_AGAIN if maxLen is 0 and more content available
+     */
+    size_t getLog(uint8_t *targetBuf, size_t maxLen, size_t index, LogReadState &state)
+    {
+        return getLogSince(0, targetBuf, maxLen, index, state);
+    }
+
+    /** Same as getLog(), but delivers only the content logged after sequence number since, see beginRead(). */
+    size_t getLogSince(const size_t since, uint8_t *targetBuf, size_t maxLen, size_t index, LogReadState &state)
+    {
+        if (0 == index)
+            beginRead(state, since);
+        return readLog(targetBuf, maxLen, state);
+    }
+};
+
+/**
+ * Request-specific state of a merged read with readMergedLog(), managed by it - except rawPercent, which is set by the caller.
+ */
+struct LogMergeReadState
+{
+    LogReadState logs[LOGBUFFER_MERGE_CHANNELS];
+    size_t end[LOGBUFFER_MERGE_CHANNELS]; // end of read per log, logs[i].end is limited to the entry currently delivered
+    int8_t current;                       // log of the entry currently delivered, -1 if next entry is to be selected
+    bool rawPercent = false;              // see LogReadState
+};
+
+/**
+ * Sequence numbers of several logs, one per log, as cursor of a merged read (see beginMergedRead()).
+ */
+struct LogMergeSeq
+{
+    size_t seq[LOGBUFFER_MERGE_CHANNELS] = {};
+};
+
+/**
+ * Starts a merged read of the content logged after since, per log the same as LogBuffer::beginRead(). Continued by readMergedLog().
+ * 
+ * @param logs to be merged, at most LOGBUFFER_MERGE_CHANNELS (otherwise nothing is read)
+ * @param since sequence numbers as returned by a previous beginMergedRead() or getMergedSeq(), all 0 reads all content
+ * @return sequence numbers at the end of this read, to be used as since for the next read
+ */
+LogMergeSeq beginMergedRead(LogBuffer *const *logs, uint8_t count, LogMergeReadState &state, const LogMergeSeq &since = LogMergeSeq())
+{
+    LogMergeSeq end;
+    if (count > LOGBUFFER_MERGE_CHANNELS)
+        count = 0; // more than state can hold
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        state.logs[i].rawPercent = state.rawPercent;
+        end.seq[i] = logs[i]->beginRead(state.logs[i], since.seq[i]);
+        state.end[i] = end.seq[i];
+    }
+    state.current = -1;
+    return end;
+}
+
+/** @return sequence numbers of the next characters to be logged, like LogBuffer::getSeq() per log */
+LogMergeSeq getMergedSeq(LogBuffer *const *logs, const uint8_t count)
+{
+    LogMergeSeq seq;
+    for (uint8_t i = 0; (i < count) && (i < LOGBUFFER_MERGE_CHANNELS); ++i)
+        seq.seq[i] = logs[i]->getSeq();
+    return seq;
+}
+
+/**
+ * Continues a read started with beginMergedRead(): entries of logs with binary log records (see LogBuffer::writeRecord()) are delivered ordered by LogRecord::millis.
+ * Content which is not part of a record (e.g. after a resync) is delivered first.
+ * 
+ * @param logs the same as given to beginMergedRead()
+ * @return number of bytes filled into buf, or 0 if there is no more data available, or RESPONSE_TRY_AGAIN if maxLen is 0
+ */
+size_t readMergedLog(LogBuffer *const *logs, const uint8_t count, uint8_t *buf, const size_t maxLen, LogMergeReadState &state)
+{
+    if (count > LOGBUFFER_MERGE_CHANNELS)
+        return 0; // more than state can hold
+    if (0 == maxLen)
+        return RESPONSE_TRY_AGAIN;
+    size_t filled = 0;
+    while (filled < maxLen)
+    {
+        if (state.current < 0)
+        { // select the oldest entry
+            uint32_t oldest = 0;
+            size_t oldestEnd = 0;
+            for (uint8_t i = 0; i < count; ++i)
             {
-                LOGBUFFER_DEBUG("    logBuffer: all maxLen=", maxLen)
-                LOGBUFFER_DEBUG(", index=", index)
-                LOGBUFFER_DEBUGN(", bufferRollIndex=", bufferRollIndex)
-                // result = ((appendIndex - index) < maxLen) ? (appendIndex - index) : maxLen;
-                // memcpy(targetBuf, &buf[index], result);
-                result = copyLog(targetBuf, maxLen, index, &_buffer[0], bufferRollIndex);
+                LogRecord record;
+                size_t nextSeq;
+                state.logs[i].end = state.end[i];
+                if (!logs[i]->peekRecord(state.logs[i], record, nextSeq))
+                    continue;
+                if ((state.current < 0) || (0 == record.level) || ((int32_t)(record.millis - oldest) < 0))
+                {
+                    state.current = i;
+                    oldest = record.millis;
+                    oldestEnd = nextSeq;
+                    if (0 == record.level)
+                        break; // content outside of records first
+                }
             }
-            else
-                result = 0;
+            if (state.current < 0)
+                break;
+            state.logs[state.current].end = oldestEnd;
         }
-        MUTEX_UNLOCK;
-        return result;
+        const size_t len = logs[state.current]->readLog(&buf[filled], maxLen - filled, state.logs[state.current]);
+        if (0 == len)
+            state.current = -1;
+        filled += len;
     }
+    return filled;
+}
+
+/**
+ * Chunked read of several logs, merged as described at readMergedLog() above.
+ * 
+ * @param index logical start position, value 0 starts a new read of all content
+ */
+size_t readMergedLog(LogBuffer *const *logs, const uint8_t count, uint8_t *buf, const size_t maxLen, const size_t index, LogMergeReadState &state)
+{
+    if (0 == index)
+        beginMergedRead(logs, count, state);
+    return readMergedLog(logs, count, buf, maxLen, state);
+}
+
+/**
+ * Log sink for disabled log levels.
+ * Streaming into it with operator<< does nothing, the compiler can remove it completely.
+ * Used as Print, written content is dropped.
+ */
+class NullLog : public Print
+{
+public:
+    virtual size_t write(uint8_t) { return 1; }
+    virtual size_t write(const uint8_t *, size_t size) { return size; }
 };
+
+template <class T>
+inline NullLog &operator<<(NullLog &obj, const T &) { return obj; }
 #endif
@@ -0,0 +1,304 @@
+/*
+LogSpill - copies the log buffer in batches into rotating files, to keep more history than fits into RAM.
+
+Copyright (C) 2020  Matthias Clauß
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef LOG_SPILL_H
+#define LOG_SPILL_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "logBuffer.h"
+
+#ifndef UNIVERSALUI_LOG_SPILL_BATCH
+#define UNIVERSALUI_LOG_SPILL_BATCH 512 // bytes written at once, multiple of the flash page size (256 bytes)
+#endif
+#ifndef UNIVERSALUI_LOG_SPILL_MAX_DELAY
+#define UNIVERSALUI_LOG_SPILL_MAX_DELAY 300000 // 5min in [ms], after this an incomplete batch is written
+#endif
+#ifndef UNIVERSALUI_LOG_SPILL_FILE_SIZE
+#define UNIVERSALUI_LOG_SPILL_FILE_SIZE 32768 // files are rotated before exceeding this size
+#endif
+#ifndef UNIVERSALUI_LOG_SPILL_FILES
+#define UNIVERSALUI_LOG_SPILL_FILES 4 // number of files kept, the oldest is removed at rotation
+#endif
+#ifndef UNIVERSALUI_LOG_SPILL_PATH
+#define UNIVERSALUI_LOG_SPILL_PATH "/log" // files are named "/log0.txt" (current) to "/log3.txt" (oldest)
+#endif
+#if (UNIVERSALUI_LOG_SPILL_FILES < 1) || (UNIVERSALUI_LOG_SPILL_FILES > 10)
+#error "UNIVERSALUI_LOG_SPILL_FILES must be between 1 and 10"
+#endif
+#define LOG_SPILL_COPY_CHUNK 32 // bytes read at once from file if '%' has to be encoded
+
+/**
+ * Request-specific state of a chunked read with <code>LogSpill::getLog()</code>, managed by LogSpill - except rawPercent, which is set by the caller.
+ */
+struct LogSpillReadState
+{
+    LogReadState log;   // in-RAM tail, continues exactly where the file content ends
+    fs::File file;      // currently read file
+    uint8_t filesLeft;  // number of files still to read, the next one is the newer file
+    uint32_t rotations; // of LogSpill at start of read, to find files renamed meanwhile
+    size_t currentSize; // size of the current file at start of read, content appended later is delivered from RAM
+    size_t remaining;   // bytes still to read from file
+    bool pendingPercent; // second '%' of an encoded "%%" still to deliver
+    bool inRam;          // if all files are delivered
+    bool continued;      // if the in-RAM tail has been extended to the content logged till now
+    bool rawPercent = false; // if '%' should not be encoded, see LogReadState
+};
+
+/**
+ * Background sink for LogBuffer: content is copied into the current file in batches of UNIVERSALUI_LOG_SPILL_BATCH bytes,
+ * each batch is a single append on the filesystem. Driven by <code>UniversalUI::handle()</code> while there is no activity,
+ * if <code>UNIVERSALUI_LOG_SPILL</code> is defined and <code>UniversalUI::enableLogSpill()</code> has been called.
+ *
+ * If the current file would exceed UNIVERSALUI_LOG_SPILL_FILE_SIZE, files are rotated by renaming, so their order survives a reset.
+ * If logging overruns the sink, the file contains the same "[...] " marker as a chunked read.
+ *
+ * getLog() delivers the files (oldest first), followed by the in-RAM content not yet written.
+ */
+class LogSpill
+{
+private:
+    fs::FS *_fs = nullptr;
+    LogReadState _readState;      // position of the sink in the log buffer
+    LogReadState _committedState; // position after the last batch written, copied by readers
+    size_t _currentSize = 0;      // of current file
+    size_t _committedSize = 0;    // of current file after the last batch written
+    volatile uint32_t _rotations = 0;
+    unsigned long _lastSpillMillis = 0;
+    uint8_t _batch[UNIVERSALUI_LOG_SPILL_BATCH];
+
+    /** @param i 0 for the current file, UNIVERSALUI_LOG_SPILL_FILES-1 for the oldest */
+    static String fileName(const uint8_t i)
+    {
+        String name = F(UNIVERSALUI_LOG_SPILL_PATH);
+        name += (char)('0' + i);
+        name += F(".txt");
+        return name;
+    }
+
+    void rotate()
+    {
+        _fs->remove(fileName(UNIVERSALUI_LOG_SPILL_FILES - 1));
+        for (uint8_t i = UNIVERSALUI_LOG_SPILL_FILES - 1; i > 0; --i)
+            _fs->rename(fileName(i - 1), fileName(i));
+        MUTEX_LOCK
+        ++_rotations;
+        _currentSize = 0;
+        _committedSize = 0;
+        MUTEX_UNLOCK
+    }
+
+    /** Writes the next batch of log content. @return number of bytes written */
+    size_t spillBatch(LogBuffer &log)
+    {
+        size_t len = 0;
+        while (len < UNIVERSALUI_LOG_SPILL_BATCH)
+        {
+            const size_t n = log.readFollow(&_batch[len], UNIVERSALUI_LOG_SPILL_BATCH - len, _readState);
+            if (0 == n)
+                break;
+            len += n;
+        }
+        _lastSpillMillis = millis();
+        if (0 == len)
+            return 0;
+        if ((_currentSize > 0) && ((_currentSize + len) > UNIVERSALUI_LOG_SPILL_FILE_SIZE))
+            rotate();
+        fs::File file = _fs->open(fileName(0), "a");
+        const size_t written = file ? file.write(_batch, len) : 0;
+        file.close();
+        MUTEX_LOCK
+        _currentSize += written;
+        _committedSize = _currentSize;
+        _committedState = _readState;
+        MUTEX_UNLOCK
+        return written;
+    }
+
+    /** @return bytes pending in the log buffer, approximately (record headers are longer when formatted) */
+    size_t pending(LogBuffer &log) const
+    {
+        const size_t head = log.getSeq();
+        return (head >= _readState.seq) ? (head - _readState.seq) : UNIVERSALUI_LOG_SPILL_BATCH; // wrapped sequence number
+    }
+
+    /** Opens the next file to read, skipping files no longer available. @return false if there is none */
+    bool openNextFile(LogSpillReadState &state)
+    {
+        while (state.filesLeft > 0)
+        {
+            const uint8_t logical = --state.filesLeft;
+            MUTEX_LOCK
+            const uint32_t physical = logical + (_rotations - state.rotations);
+            MUTEX_UNLOCK
+            if ((physical >= UNIVERSALUI_LOG_SPILL_FILES) || !_fs->exists(fileName(physical)))
+                continue; // removed by rotation meanwhile
+            state.file = _fs->open(fileName(physical), "r");
+            if (!state.file)
+                continue;
+            state.remaining = (0 == logical) ? state.currentSize : state.file.size();
+            if (state.remaining > 0)
+                return true;
+            state.file.close();
+        }
+        return false;
+    }
+
+    /** Delivers content of the current file, '%' encoded as "%%" unless rawPercent. */
+    size_t readFile(uint8_t *buf, const size_t maxLen, LogSpillReadState &state)
+    {
+        uint8_t chunk[LOG_SPILL_COPY_CHUNK];
+        size_t filled = 0;
+        while (filled < maxLen)
+        {
+            if (state.pendingPercent)
+            {
+                buf[filled++] = '%';
+                state.pendingPercent = false;
+                continue;
+            }
+            const size_t space = maxLen - filled;
+            size_t len = state.rawPercent ? space : ((space > 1) ? space / 2 : 1);
+            if (!state.rawPercent && (len > LOG_SPILL_COPY_CHUNK))
+                len = LOG_SPILL_COPY_CHUNK;
+            if (len > state.remaining)
+                len = state.remaining;
+            const size_t n = (0 == len) ? 0 : state.file.read(state.rawPercent ? &buf[filled] : chunk, len);
+            if (0 == n)
+            {
+                state.remaining = 0;
+                break;
+            }
+            state.remaining -= n;
+            if (state.rawPercent)
+            {
+                filled += n;
+                continue;
+            }
+            for (size_t i = 0; i < n; ++i)
+            {
+                buf[filled++] = chunk[i];
+                if ('%' == chunk[i])
+                {
+                    if (filled < maxLen)
+                        buf[filled++] = '%';
+                    else
+                        state.pendingPercent = true;
+                }
+            }
+        }
+        return filled;
+    }
+
+public:
+    LogSpill()
+    {
+        _readState.rawPercent = true; // files contain content as logged
+    }
+
+    /**
+     * Starts copying the log into files on the given filesystem, beginning with the oldest content still in the log buffer.
+     * @param fs must already be mounted, e.g. <code>SPIFFS.begin()</code>
+     */
+    void begin(fs::FS &fs, LogBuffer &log)
+    {
+        log.beginRead(_readState, 0);
+        _lastSpillMillis = millis();
+        const String current = fileName(0);
+        fs::File file = fs.exists(current) ? fs.open(current, "r") : fs::File();
+        const size_t size = file ? file.size() : 0;
+        file.close();
+        MUTEX_LOCK
+        _fs = &fs;
+        _currentSize = size;
+        _committedSize = size;
+        _committedState = _readState;
+        MUTEX_UNLOCK
+    }
+
+    bool isEnabled() const { return nullptr != _fs; }
+
+    /** Writes a batch if one is complete, or if the last one is older than UNIVERSALUI_LOG_SPILL_MAX_DELAY. To be called while idle. */
+    void handle(LogBuffer &log)
+    {
+        if (nullptr == _fs)
+            return;
+        const size_t n = pending(log);
+        if ((n >= UNIVERSALUI_LOG_SPILL_BATCH) || ((n > 0) && ((millis() - _lastSpillMillis) >= UNIVERSALUI_LOG_SPILL_MAX_DELAY)))
+            spillBatch(log);
+    }
+
+    /** Writes all pending content, e.g. before a planned restart. */
+    void flush(LogBuffer &log)
+    {
+        if (nullptr == _fs)
+            return;
+        while (UNIVERSALUI_LOG_SPILL_BATCH == spillBatch(log))
+            ;
+    }
+
+    /**
+     * Chunked read of the files (oldest first), followed by the content of the log buffer not yet written to a file.
+     * Content logged while the files are read is included, content logged after reaching the log buffer is not.
+     *
+     * @param index logical start position, value 0 starts a new read
+     * @param state required request-specific state-memory, is initialized at first call (index==0)
+     * @return number of bytes filled into buf, or 0 if there is no more data available, or RESPONSE_TRY_AGAIN if maxLen is 0 and more content available
+     */
+    size_t getLog(LogBuffer &log, uint8_t *buf, const size_t maxLen, const size_t index, LogSpillReadState &state)
+    {
+        if (0 == index)
+        {
+            state.file.close();
+            state.pendingPercent = false;
+            MUTEX_LOCK
+            state.inRam = (nullptr == _fs);
+            state.continued = state.inRam;
+            state.log = _committedState;
+            state.rotations = _rotations;
+            state.currentSize = _committedSize;
+            MUTEX_UNLOCK
+            state.filesLeft = UNIVERSALUI_LOG_SPILL_FILES;
+            if (state.inRam)
+                log.beginRead(state.log, 0);
+            state.log.rawPercent = state.rawPercent;
+        }
+        if (0 == maxLen)
+            return (state.inRam && state.continued) ? log.readLog(buf, 0, state.log) : RESPONSE_TRY_AGAIN;
+        size_t filled = 0;
+        while (!state.inRam && (filled < maxLen))
+        {
+            if (!state.file && !openNextFile(state))
+            {
+                state.inRam = true;
+                break;
+            }
+            filled += readFile(&buf[filled], maxLen - filled, state);
+            if ((0 == state.remaining) && !state.pendingPercent)
+                state.file.close();
+        }
+        while (state.inRam && (filled < maxLen))
+        {
+            const size_t len = log.readLog(&buf[filled], maxLen - filled, state.log);
+            if (len > 0)
+                filled += len;
+            else if (state.continued)
+                break;
+            else
+            { // content logged after the last batch written till now
+                state.continued = true;
+                log.beginRead(state.log, state.log.end);
+            }
+        }
+        return filled;
+    }
+};
+#endif
@@ -0,0 +1,302 @@
+/*
+LogThrottle - rate limiting of log call sites and coalescing of repeated log entries.
+
+Copyright (C) 2020  Matthias Clauß
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef LOG_THROTTLE_H
+#define LOG_THROTTLE_H
+
+#include <Arduino.h>
+#include "logBuffer.h"
+
+#ifndef UNIVERSALUI_LOG_LINE_LEN
+#define UNIVERSALUI_LOG_LINE_LEN 160 // entries are collected up to this length, longer ones are written through without coalescing
+#endif
+#ifndef UNIVERSALUI_LOG_TASKS
+#if defined(ESP32)
+#define UNIVERSALUI_LOG_TASKS 4 // tasks logging with an own line stage, e.g. arduino loop, service task, AsyncTCP and WiFi events; further tasks write through
+#else
+#define UNIVERSALUI_LOG_TASKS 1
+#endif
+#endif
+#ifndef UNIVERSALUI_LOG_REPEAT_FLUSH
+#define UNIVERSALUI_LOG_REPEAT_FLUSH 30000 // [ms], pending "repeated" note (or incomplete entry) is written after this, even if no other entry follows
+#endif
+
+/**
+ * Token bucket: allows burst entries at once, refilled by burst per interval.
+ * Use one per call site with UNIVERSALUI_RATE_LIMITED().
+ */
+class LogRateLimit
+{
+private:
+    const uint16_t _burst;
+    const unsigned long _interval; // [ms]
+    uint16_t _tokens;
+    unsigned long _lastRefill;
+    uint32_t _suppressed = 0;
+
+public:
+    LogRateLimit(const uint16_t burst, const unsigned long interval) : _burst(burst), _interval(interval), _tokens(burst), _lastRefill(millis()) {}
+
+    /** @return true if the entry is to be logged, consumes a token */
+    bool allow()
+    {
+        const unsigned long elapsed = millis() - _lastRefill;
+        const uint32_t refill = (uint64_t)elapsed * _burst / _interval;
+        if (refill > 0)
+        {
+            _tokens = ((_tokens + refill) < _burst) ? (_tokens + refill) : _burst;
+            _lastRefill = (refill >= _burst) ? millis() : (_lastRefill + (uint64_t)refill * _interval / _burst);
+        }
+        if (0 == _tokens)
+        {
+            ++_suppressed;
+            return false;
+        }
+        --_tokens;
+        return true;
+    }
+
+    /** @return number of entries dropped since start */
+    uint32_t getSuppressed() const { return _suppressed; }
+};
+
+/**
+ * Prefix for a log statement, to drop it (including formatting of its arguments) if the call site exceeds burst entries per interval [ms].
+ * Example: <code>UNIVERSALUI_RATE_LIMITED(3, 60000) ui.logError() << F("sensor failed: ") << code << endl;</code>
+ * Expands to a single statement (a loop running at most once, with a LogRateLimit per call site), so it can be used in an unbraced if/else.
+ * BURST and INTERVAL must be constants.
+ */
+#define UNIVERSALUI_RATE_LIMITED(BURST, INTERVAL)                          \
+    for (bool _logRateAllowed = []() {                                     \
+             static LogRateLimit limit(BURST, INTERVAL);                   \
+             return limit.allow();                                         \
+         }();                                                              \
+         _logRateAllowed; _logRateAllowed = false)
+
+#if defined(ESP32)
+#include <freertos/semphr.h>
+typedef TaskHandle_t LogTaskHandle;
+#define LOG_THROTTLE_TASK xTaskGetCurrentTaskHandle()
+#define LOG_THROTTLE_LOCK xSemaphoreTake(_mutex, portMAX_DELAY);
+#define LOG_THROTTLE_UNLOCK xSemaphoreGive(_mutex);
+#else
+typedef void *LogTaskHandle;
+#define LOG_THROTTLE_TASK ((LogTaskHandle)1) // only one task logs
+#define LOG_THROTTLE_LOCK ;
+#define LOG_THROTTLE_UNLOCK ;
+#endif
+
+/** Log entry being collected by one task. */
+struct LogLineStage
+{
+    LogTaskHandle task = nullptr; // owner, nullptr if unused
+    LogBuffer *target = nullptr;  // of current entry
+    LogRecord record;             // of current entry
+    bool collecting = false;      // if current entry is collected in line, otherwise written through
+    size_t lineLen = 0;
+    char line[UNIVERSALUI_LOG_LINE_LEN];
+};
+
+/**
+ * Collects a log entry till its end of line, then writes it together with its prefix with a single append into the log buffer.
+ * Each task (up to UNIVERSALUI_LOG_TASKS) collects into an own LogLineStage, so entries logged by several tasks don't interleave.
+ * If it equals the previous entry (same level and text, compared by hash), it is dropped and counted instead,
+ * the count is written as "last message repeated N times" before the next different entry, or after UNIVERSALUI_LOG_REPEAT_FLUSH.
+ *
+ * Used by UniversalUI if <code>UNIVERSALUI_LOG_COALESCE</code> (or <code>UNIVERSALUI_SERVICE_TASK</code>, without coalescing) is defined.
+ * On ESP32 the stages and the repetition count are guarded by a mutex, so don't log from an ISR.
+ */
+class LogCoalescer : public Print
+{
+private:
+    LogRecordFormatter _prefixFormatter; // for text prefix, nullptr to write binary log records
+    const bool _coalesce;                // if repetitions are counted, otherwise entries are only staged
+    LogLineStage _stages[UNIVERSALUI_LOG_TASKS];
+    bool _hasLast = false; // if _lastHash is valid
+    uint32_t _lastHash = 0;
+    LogBuffer *_repeatTarget = nullptr;
+    LogRecord _repeatRecord; // of last dropped repetition
+    unsigned long _repeatStart = 0; // millis of first dropped repetition
+    uint32_t _repeats = 0;
+#if defined(ESP32)
+    StaticSemaphore_t _mutexBuffer;
+    SemaphoreHandle_t _mutex = xSemaphoreCreateMutexStatic(&_mutexBuffer);
+#endif
+
+    static uint32_t hashOf(const uint8_t level, const char *text, const size_t len)
+    {
+        uint32_t hash = (2166136261UL ^ level) * 16777619UL; // FNV-1a
+        for (size_t i = 0; i < len; ++i)
+            hash = (hash ^ (uint8_t)text[i]) * 16777619UL;
+        return hash;
+    }
+
+    /** @return stage of the calling task, assigned at its first entry; nullptr if UNIVERSALUI_LOG_TASKS is exceeded */
+    LogLineStage *stageOfTask()
+    {
+        const LogTaskHandle task = LOG_THROTTLE_TASK;
+        LogLineStage *unused = nullptr;
+        for (uint8_t i = 0; i < UNIVERSALUI_LOG_TASKS; ++i)
+        {
+            if (task == _stages[i].task)
+                return &_stages[i];
+            if ((nullptr == unused) && (nullptr == _stages[i].task))
+                unused = &_stages[i];
+        }
+        if (nullptr != unused)
+            unused->task = task;
+        return unused;
+    }
+
+    void writePrefix(LogBuffer &log, const LogRecord &record)
+    {
+        if (nullptr == _prefixFormatter)
+        {
+            log.writeRecord(record);
+            return;
+        }
+        char text[LOGBUFFER_RECORD_TEXT_LEN];
+        const size_t len = _prefixFormatter(record, text, sizeof(text));
+        log.write((const uint8_t *)text, len);
+    }
+    void writeEntry(LogBuffer &log, const LogRecord &record, const char *text, const size_t len)
+    {
+        if (nullptr == _prefixFormatter)
+        {
+            log.writeEntry(record, text, len);
+            return;
+        }
+        char prefix[LOGBUFFER_RECORD_TEXT_LEN];
+        const size_t prefixLen = _prefixFormatter(record, prefix, sizeof(prefix));
+        log.writeEntry(prefix, prefixLen, text, len);
+    }
+
+    void flushRepeats()
+    {
+        if (0 == _repeats)
+            return;
+        char text[40];
+        const int len = snprintf_P(text, sizeof(text), (1 == _repeats) ? PSTR("last message repeated %lu time\n") : PSTR("last message repeated %lu times\n"), (unsigned long)_repeats);
+        writeEntry(*_repeatTarget, _repeatRecord, text, len);
+        _repeats = 0;
+    }
+
+    /** Writes collected part of the entry, the rest is written through. */
+    void commit(LogLineStage &stage)
+    {
+        flushRepeats();
+        writeEntry(*stage.target, stage.record, stage.line, stage.lineLen);
+        stage.collecting = false;
+        _hasLast = false; // incomplete entries are not coalesced
+    }
+
+    void finishEntry(LogLineStage &stage)
+    {
+        const uint32_t hash = hashOf(stage.record.level, stage.line, stage.lineLen);
+        stage.collecting = false;
+        if (_coalesce && _hasLast && (hash == _lastHash) && (_repeatTarget == stage.target))
+        {
+            if (0 == _repeats++)
+                _repeatStart = stage.record.millis;
+            _repeatRecord = stage.record;
+            return;
+        }
+        flushRepeats();
+        writeEntry(*stage.target, stage.record, stage.line, stage.lineLen);
+        _hasLast = true;
+        _lastHash = hash;
+        _repeatTarget = stage.target;
+    }
+
+public:
+    /**
+     * @param prefixFormatter formats the prefix of an entry as text, nullptr to write binary log records
+     * @param coalesce false to only stage the entries
+     */
+    LogCoalescer(LogRecordFormatter prefixFormatter, const bool coalesce = true) : _prefixFormatter(prefixFormatter), _coalesce(coalesce) {}
+
+    /**
+     * Starts a new entry of the calling task, an incomplete previous one is written as is (if it has any text).
+     * @return this, or target with the prefix already written if UNIVERSALUI_LOG_TASKS is exceeded
+     */
+    Print &begin(LogBuffer &target, const LogRecord &record)
+    {
+        LOG_THROTTLE_LOCK
+        LogLineStage *stage = stageOfTask();
+        if (nullptr == stage)
+        {
+            LOG_THROTTLE_UNLOCK
+            writePrefix(target, record);
+            return target;
+        }
+        if (stage->collecting && (stage->lineLen > 0))
+            commit(*stage); // an entry without text is dropped, it would be a bare prefix
+        stage->target = &target;
+        stage->record = record;
+        stage->lineLen = 0;
+        stage->collecting = true;
+        LOG_THROTTLE_UNLOCK
+        return *this;
+    }
+
+    /** Writes a pending "repeated" note or incomplete entries after UNIVERSALUI_LOG_REPEAT_FLUSH. To be called in <code>loop()</code>. */
+    void handle()
+    {
+        LOG_THROTTLE_LOCK
+        if ((_repeats > 0) && ((millis() - _repeatStart) >= UNIVERSALUI_LOG_REPEAT_FLUSH))
+        {
+            flushRepeats();
+            _hasLast = false; // next repetition is logged again
+        }
+        for (uint8_t i = 0; i < UNIVERSALUI_LOG_TASKS; ++i)
+        {
+            LogLineStage &stage = _stages[i];
+            if (stage.collecting && (stage.lineLen > 0) && ((millis() - stage.record.millis) >= UNIVERSALUI_LOG_REPEAT_FLUSH))
+                commit(stage);
+        }
+        LOG_THROTTLE_UNLOCK
+    }
+
+    using Print::write;
+    virtual size_t write(uint8_t c)
+    {
+        return write(&c, 1);
+    }
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        LOG_THROTTLE_LOCK
+        LogLineStage *stage = stageOfTask();
+        size_t written = 0;
+        while ((nullptr != stage) && (nullptr != stage->target) && (written < size))
+        {
+            if (!stage->collecting)
+            { // rest of a long entry, or text after its end of line
+                stage->target->write(&buffer[written], size - written);
+                break;
+            }
+            const uint8_t *newline = (const uint8_t *)memchr(&buffer[written], '\n', size - written);
+            const size_t len = (nullptr == newline) ? (size - written) : (newline - &buffer[written] + 1);
+            if ((stage->lineLen + len) > UNIVERSALUI_LOG_LINE_LEN)
+            {
+                commit(*stage);
+                continue;
+            }
+            memcpy(&stage->line[stage->lineLen], &buffer[written], len);
+            stage->lineLen += len;
+            written += len;
+            if (nullptr != newline)
+                finishEntry(*stage);
+        }
+        LOG_THROTTLE_UNLOCK
+        return size;
+    }
+};
+#endif
@@ -0,0 +1,160 @@
+/*
+PerfProfiler - optional measurement of loop latency and critical section hold times.
+
+Copyright (C) 2020  Matthias Clauß
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PERF_PROFILER_H
+#define PERF_PROFILER_H
+
+#include <Arduino.h>
+
+/**
+ * Enabled with <code>#define UNIVERSALUI_PROFILE</code> before including universalUI, otherwise all probes compile to nothing.
+ *
+ * Measures in CPU cycles (ESP32/ESP8266, via <code>ESP.getCycleCount()</code>) or [us] elsewhere:<ul>
+ * <li>duration of <code>UniversalUI::handle()</code> and of its steps (status LED, WiFi, OTA, NTP)</li>
+ * <li>hold time of critical sections in LogBuffer and AppendBuffer</li>
+ * </ul>
+ * Each probe keeps count, min, max, sum and a histogram with buckets growing by factor 16.
+ * Published via placeholder <code>%PERF%</code> and <code>handlePerf()</code> (JSON), see webUiGenericPlaceHolder.h.
+ */
+#ifdef UNIVERSALUI_PROFILE
+
+enum PerfProbe : uint8_t
+{
+    PERF_HANDLE,
+    PERF_HANDLE_LED,
+    PERF_HANDLE_WIFI,
+    PERF_HANDLE_OTA,
+    PERF_HANDLE_NTP,
+    PERF_LOGBUFFER_LOCK,
+    PERF_APPENDBUFFER_LOCK,
+    NUM_PERF_PROBES
+};
+const char *const PERF_PROBE_NAMES[NUM_PERF_PROBES] = {"handle", "led", "wifi", "ota", "ntp", "logLock", "appendLock"};
+
+#define PERF_HISTOGRAM_BUCKETS 8 // bucket i counts durations below 16^(i+1) cycles, last one all above
+
+struct PerfStat
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t histogram[PERF_HISTOGRAM_BUCKETS];
+};
+PerfStat perfStats[NUM_PERF_PROBES];
+volatile uint32_t perfLockStart; // start of the outermost critical section held
+uint8_t perfLockDepth;           // critical sections nest (e.g. AppendBuffer inside of LogBuffer), only the outermost one is measured
+
+#if defined(ESP32) || defined(ESP8266)
+#define PERF_CYCLES ESP.getCycleCount()
+#define PERF_CYCLES_PER_US ESP.getCpuFreqMHz()
+#else
+#define PERF_CYCLES micros()
+#define PERF_CYCLES_PER_US 1
+#endif
+
+inline void perfRecord(const PerfProbe probe, const uint32_t cycles)
+{
+    PerfStat &stat = perfStats[probe];
+    if ((0 == stat.count) || (cycles < stat.min))
+        stat.min = cycles;
+    if (cycles > stat.max)
+        stat.max = cycles;
+    ++stat.count;
+    stat.sum += cycles;
+    const uint8_t bucket = (0 == cycles) ? 0 : (31 - __builtin_clz(cycles)) / 4;
+    ++stat.histogram[(bucket < PERF_HISTOGRAM_BUCKETS) ? bucket : (PERF_HISTOGRAM_BUCKETS - 1)];
+}
+
+void resetPerfStats()
+{
+    memset(perfStats, 0, sizeof(perfStats));
+}
+
+/** Prints one line per probe with count and min/avg/max in [us], for use in HTML. */
+size_t printPerfStats(Print &out)
+{
+    const uint32_t cyclesPerUs = PERF_CYCLES_PER_US;
+    size_t len = 0;
+    for (uint8_t i = 0; i < NUM_PERF_PROBES; ++i)
+    {
+        const PerfStat &stat = perfStats[i];
+        len += out.print(PERF_PROBE_NAMES[i]);
+        len += out.print(F(": n="));
+        len += out.print(stat.count);
+        if (stat.count > 0)
+        {
+            len += out.print(F(" min="));
+            len += out.print(stat.min / cyclesPerUs);
+            len += out.print(F(" avg="));
+            len += out.print((uint32_t)(stat.sum / stat.count / cyclesPerUs));
+            len += out.print(F(" max="));
+            len += out.print(stat.max / cyclesPerUs);
+            len += out.print(F(" us"));
+        }
+        len += out.print(F("<br>\n"));
+    }
+    return len;
+}
+
+/** Prints all probes as JSON object, durations in cycles (see cyclesPerUs). */
+size_t printPerfJson(Print &out)
+{
+    size_t len = out.print(F("{\"cyclesPerUs\":"));
+    len += out.print((uint32_t)PERF_CYCLES_PER_US);
+    for (uint8_t i = 0; i < NUM_PERF_PROBES; ++i)
+    {
+        const PerfStat &stat = perfStats[i];
+        len += out.print(F(",\""));
+        len += out.print(PERF_PROBE_NAMES[i]);
+        len += out.print(F("\":{\"count\":"));
+        len += out.print(stat.count);
+        len += out.print(F(",\"min\":"));
+        len += out.print(stat.min);
+        len += out.print(F(",\"max\":"));
+        len += out.print(stat.max);
+        len += out.print(F(",\"avg\":"));
+        len += out.print((uint32_t)((stat.count > 0) ? (stat.sum / stat.count) : 0));
+        len += out.print(F(",\"histogram\":["));
+        for (uint8_t b = 0; b < PERF_HISTOGRAM_BUCKETS; ++b)
+        {
+            if (b > 0)
+                len += out.print(',');
+            len += out.print(stat.histogram[b]);
+        }
+        len += out.print(F("]}"));
+    }
+    len += out.print('}');
+    return len;
+}
+
+#define PERF_BEGIN(V) const uint32_t V = PERF_CYCLES;
+#define PERF_END(PROBE, V) perfRecord(PROBE, PERF_CYCLES - (V));
+// to be used inside of the critical section: after entering, before leaving
+#define PERF_LOCK_BEGIN                                     \
+    {                                                       \
+        if (0 == perfLockDepth++)                           \
+            perfLockStart = PERF_CYCLES;                    \
+    }
+#define PERF_LOCK_END(PROBE)                                \
+    {                                                       \
+        if (0 == --perfLockDepth)                           \
+            perfRecord(PROBE, PERF_CYCLES - perfLockStart); \
+    }
+
+#else
+#define PERF_BEGIN(V) ;
+#define PERF_END(PROBE, V) ;
+#define PERF_LOCK_BEGIN ;
+#define PERF_LOCK_END(PROBE) ;
+#endif //of: #ifdef UNIVERSALUI_PROFILE
+
+#endif
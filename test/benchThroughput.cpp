@@ -0,0 +1,107 @@
+// throughput of logging and of delivering the log, as baseline for performance changes: make bench
+#define LOGBUF_LENGTH 8192
+#include <chrono>
+#include "ESPAsyncWebServer.h"
+#include "webUiGenericPlaceHolder.h"
+#include "gzipDataSource.h"
+
+UniversalUI ui = UniversalUI("bench");
+
+const char *const LINE = "    1234   INFO  \tmeasured 23.5 degrees at sensor 3, humidity 45%\n";
+const double MIN_SECONDS = 0.2; // each measurement is repeated at least this long
+
+/** Runs step repeatedly, prints bytes/s of the bytes returned by step. */
+template <typename Step>
+void measure(const char *name, Step step)
+{
+    const auto start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    unsigned long long bytes = 0;
+    do
+    {
+        for (int i = 0; i < 16; ++i)
+            bytes += step();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < MIN_SECONDS);
+    printf("%-48s %10.1f MB/s\n", name, bytes / seconds / 1e6);
+}
+
+/** @return number of bytes delivered by source, maxLen bytes per call */
+size_t respond(AwsResponseDataSource &source, const size_t maxLen)
+{
+    static uint8_t buf[4096];
+    size_t total = 0;
+    size_t len;
+    while ((len = source.fillBuffer(buf, maxLen, total)) > 0)
+        if (RESPONSE_TRY_AGAIN != len)
+            total += len;
+    return total;
+}
+
+int main()
+{
+    static char memory[LOGBUF_LENGTH];
+    LogBuffer log(sizeof(memory), memory, true);
+    const size_t lineLen = strlen(LINE);
+
+    measure("LogBuffer::write(char)", [&]() {
+        for (size_t i = 0; i < lineLen; ++i)
+            log.write((uint8_t)LINE[i]);
+        return lineLen;
+    });
+    measure("LogBuffer::write(line)", [&]() { return log.write((const uint8_t *)LINE, lineLen); });
+
+    static uint8_t buf[4096];
+    for (const size_t maxLen : {64, 256, 1024, 4096})
+        for (const bool rawPercent : {true, false})
+        {
+            char name[64];
+            snprintf(name, sizeof(name), "LogBuffer::getLog() maxLen=%u%s", (unsigned)maxLen, rawPercent ? "" : " encoding '%'");
+            measure(name, [&]() {
+                LogReadState state;
+                state.rawPercent = rawPercent;
+                size_t total = 0;
+                size_t len;
+                while ((len = log.getLog(buf, maxLen, total, state)) > 0)
+                    total += len;
+                return total;
+            });
+        }
+
+    for (size_t i = 0; i < LOGBUF_LENGTH / lineLen; ++i)
+        ui.logInfo() << "measured 23.5 degrees at sensor 3, humidity 45%" << endl;
+    std::string page = "<html><head><title>%APPNAME%</title></head><body>\n";
+    for (int i = 0; i < 40; ++i)
+        page += "<p>some static content of the page, with a placeholder %APPNAME% now and then</p>\n";
+    page += "<pre>$LOG$</pre></body></html>\n";
+    SPIFFS.put("/log.html", page);
+    SPIFFS.put("/cached.html", page);
+    cacheTemplate(SPIFFS, "/cached.html");
+    for (const size_t maxLen : {256, 1460, 4096})
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "FileWithLogBufferResponseDataSource maxLen=%u", (unsigned)maxLen);
+        measure(name, [&]() {
+            FileWithLogBufferResponseDataSource source(SPIFFS, "/log.html");
+            return respond(source, maxLen);
+        });
+        snprintf(name, sizeof(name), "TemplateResponseDataSource maxLen=%u", (unsigned)maxLen);
+        measure(name, [&]() {
+            TemplateResponseDataSource source(SPIFFS, "/log.html");
+            return respond(source, maxLen);
+        });
+        snprintf(name, sizeof(name), "TemplateResponseDataSource cached maxLen=%u", (unsigned)maxLen);
+        measure(name, [&]() {
+            TemplateResponseDataSource source(SPIFFS, "/cached.html");
+            return respond(source, maxLen);
+        });
+    }
+    TemplateResponseDataSource uncompressedSource(SPIFFS, "/cached.html");
+    const size_t uncompressed = respond(uncompressedSource, 4096);
+    measure("GzipResponseDataSource (uncompressed bytes)", [&]() {
+        GzipResponseDataSource gzip(new TemplateResponseDataSource(SPIFFS, "/cached.html"));
+        respond(gzip, 1460);
+        return uncompressed;
+    });
+    return 0;
+}
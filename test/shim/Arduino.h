@@ -0,0 +1,210 @@
+/*
+Arduino shim for host builds of the unit tests and benchmarks, see test/Makefile.
+Provides only what the headers of universalUI use; flash access maps to plain memory, millis() is controlled by the test.
+
+Copyright (C) 2020  Matthias Clauß
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef uint16_t word;
+typedef bool boolean;
+
+// program memory is plain memory on the host
+class __FlashStringHelper;
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define F(s) ((const __FlashStringHelper *)(s))
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define memcpy_P memcpy
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+
+#define NOT_A_PIN -1
+#define DEC 10
+#define HEX 16
+
+// time is advanced by the test, so timeouts are deterministic
+extern unsigned long shimMillis;
+inline unsigned long millis() { return shimMillis; }
+inline unsigned long micros() { return shimMillis * 1000; }
+inline void delay(unsigned long ms) { shimMillis += ms; }
+inline void yield() {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+class String
+{
+private:
+    std::string _s;
+
+public:
+    String(const char *s = "") : _s(s) {}
+    String(const __FlashStringHelper *s) : _s((const char *)s) {}
+    String(const std::string &s) : _s(s) {}
+    explicit String(const char c) : _s(1, c) {}
+    explicit String(const int v) : _s(std::to_string(v)) {}
+    explicit String(const unsigned int v) : _s(std::to_string(v)) {}
+    explicit String(const long v) : _s(std::to_string(v)) {}
+    explicit String(const unsigned long v) : _s(std::to_string(v)) {}
+
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.length(); }
+    long toInt() const { return atol(_s.c_str()); }
+    int indexOf(const char *s) const
+    {
+        const size_t found = _s.find(s);
+        return (std::string::npos == found) ? -1 : (int)found;
+    }
+    bool operator==(const String &other) const { return _s == other._s; }
+    bool operator==(const char *other) const { return _s == other; }
+    bool operator!=(const String &other) const { return _s != other._s; }
+    String &operator+=(const String &s)
+    {
+        _s += s._s;
+        return *this;
+    }
+    String &operator+=(const char *s)
+    {
+        _s += s;
+        return *this;
+    }
+    String &operator+=(const __FlashStringHelper *s)
+    {
+        _s += (const char *)s;
+        return *this;
+    }
+    String &operator+=(const char c)
+    {
+        _s += c;
+        return *this;
+    }
+    friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+};
+
+class Print
+{
+private:
+    size_t printNumber(unsigned long long n, const uint8_t base, const bool negative)
+    {
+        char buf[24];
+        char *pos = &buf[sizeof(buf) - 1];
+        *pos = '\0';
+        do
+        {
+            const uint8_t digit = n % base;
+            *--pos = (digit < 10) ? ('0' + digit) : ('A' + digit - 10);
+            n /= base;
+        } while (n > 0);
+        if (negative)
+            *--pos = '-';
+        return write(pos);
+    }
+
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--)
+            n += write(*buffer++);
+        return n;
+    }
+    size_t write(const char *str) { return (nullptr == str) ? 0 : write((const uint8_t *)str, strlen(str)); }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    virtual int availableForWrite() { return 0; }
+
+    size_t print(const __FlashStringHelper *s) { return write((const char *)s); }
+    size_t print(const String &s) { return write(s.c_str()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(const char c) { return write((uint8_t)c); }
+    size_t print(const unsigned char n, const int base = DEC) { return printNumber(n, base, false); }
+    size_t print(const int n, const int base = DEC) { return print((long)n, base); }
+    size_t print(const unsigned int n, const int base = DEC) { return printNumber(n, base, false); }
+    size_t print(const long n, const int base = DEC) { return ((n < 0) && (DEC == base)) ? printNumber(-(long long)n, base, true) : printNumber((unsigned long)n, base, false); }
+    size_t print(const unsigned long n, const int base = DEC) { return printNumber(n, base, false); }
+    size_t print(const long long n, const int base = DEC) { return ((n < 0) && (DEC == base)) ? printNumber(-n, base, true) : printNumber(n, base, false); }
+    size_t print(const unsigned long long n, const int base = DEC) { return printNumber(n, base, false); }
+    size_t print(const double n, const int digits = 2)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*f", digits, n);
+        return write(buf);
+    }
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &v) { return print(v) + println(); }
+    size_t printf(const char *format, ...)
+    {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        const int len = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        return write((const uint8_t *)buf, (len < (int)sizeof(buf)) ? len : sizeof(buf) - 1);
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+    size_t readBytes(uint8_t *buffer, size_t length)
+    {
+        size_t n = 0;
+        while ((n < length) && (available() > 0))
+            buffer[n++] = read();
+        return n;
+    }
+    void setTimeout(unsigned long) {}
+};
+
+/** Collects output in written, accepts availableForWrite bytes per call of availableForWrite() (unlimited if negative). */
+class HardwareSerial : public Stream
+{
+public:
+    std::string written;
+    int writeSpace = -1;
+
+    void begin(unsigned long) {}
+    void end() {}
+    operator bool() const { return true; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    int availableForWrite() override { return (writeSpace < 0) ? 4096 : writeSpace; }
+    size_t write(uint8_t c) override
+    {
+        written += (char)c;
+        return 1;
+    }
+    using Print::write;
+};
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,105 @@
+/*
+Shim of ESPAsyncWebServer for host builds, see test/Makefile: only the response data source interface and a request recording its response.
+*/
+#ifndef ESPASYNCWEBSERVER_SHIM_H
+#define ESPASYNCWEBSERVER_SHIM_H
+#include "Arduino.h"
+#include "FS.h"
+#include <functional>
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+typedef std::function<size_t(uint8_t *, size_t, size_t)> AwsResponseFiller;
+
+class AwsResponseDataSource
+{
+public:
+    virtual ~AwsResponseDataSource() {}
+    virtual size_t fillBuffer(uint8_t *buf, size_t maxLen, size_t index) = 0;
+};
+
+class AsyncWebParameter
+{
+private:
+    String _value;
+
+public:
+    AsyncWebParameter(const String &value) : _value(value) {}
+    const String &value() const { return _value; }
+};
+
+class AsyncWebHeader
+{
+private:
+    String _value;
+
+public:
+    AsyncWebHeader(const String &value) : _value(value) {}
+    const String &value() const { return _value; }
+};
+
+class AsyncWebServerResponse
+{
+public:
+    AwsResponseFiller filler;
+    String contentType;
+    std::map<std::string, std::string> headers;
+
+    virtual ~AsyncWebServerResponse() {}
+    void addHeader(const String &name, const String &value) { headers[name.c_str()] = value.c_str(); }
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print
+{
+public:
+    std::string body;
+    size_t write(uint8_t c) override
+    {
+        body += (char)c;
+        return 1;
+    }
+    using Print::write;
+};
+
+/** Request with parameters and headers given by the test, send() keeps the response for inspection. */
+class AsyncWebServerRequest
+{
+private:
+    std::map<std::string, AsyncWebParameter> _params;
+    std::map<std::string, AsyncWebHeader> _headers;
+
+public:
+    std::unique_ptr<AsyncWebServerResponse> response;
+
+    void setParam(const String &name, const String &value) { _params.insert_or_assign(name.c_str(), AsyncWebParameter(value)); }
+    void setHeader(const String &name, const String &value) { _headers.insert_or_assign(name.c_str(), AsyncWebHeader(value)); }
+
+    bool hasParam(const String &name) const { return _params.end() != _params.find(name.c_str()); }
+    AsyncWebParameter *getParam(const String &name)
+    {
+        auto found = _params.find(name.c_str());
+        return (_params.end() == found) ? nullptr : &found->second;
+    }
+    bool hasHeader(const String &name) const { return _headers.end() != _headers.find(name.c_str()); }
+    AsyncWebHeader *getHeader(const String &name)
+    {
+        auto found = _headers.find(name.c_str());
+        return (_headers.end() == found) ? nullptr : &found->second;
+    }
+
+    AsyncWebServerResponse *beginChunkedResponse(const String &contentType, AwsResponseFiller filler)
+    {
+        AsyncWebServerResponse *r = new AsyncWebServerResponse();
+        r->contentType = contentType;
+        r->filler = filler;
+        return r;
+    }
+    AsyncResponseStream *beginResponseStream(const String &contentType)
+    {
+        AsyncResponseStream *r = new AsyncResponseStream();
+        r->contentType = contentType;
+        return r;
+    }
+    void send(AsyncWebServerResponse *r) { response.reset(r); }
+};
+#endif
@@ -0,0 +1,115 @@
+/*
+Shim of the Arduino filesystem API for host builds, see test/Makefile: files are kept in memory.
+*/
+#ifndef FS_SHIM_H
+#define FS_SHIM_H
+#include "Arduino.h"
+#include <time.h>
+#include <map>
+#include <memory>
+
+extern time_t shimFileTime; // modification time given to files written
+
+namespace fs
+{
+    struct FileData
+    {
+        std::string content;
+        time_t lastWrite = 0;
+    };
+
+    class File
+    {
+    private:
+        std::shared_ptr<FileData> _data;
+        size_t _pos = 0;
+        bool _writable = false;
+
+    public:
+        File() {}
+        File(std::shared_ptr<FileData> data, const size_t pos, const bool writable) : _data(data), _pos(pos), _writable(writable) {}
+
+        operator bool() const { return nullptr != _data; }
+        size_t size() const { return _data ? _data->content.size() : 0; }
+        size_t position() const { return _pos; }
+        time_t getLastWrite() const { return _data ? _data->lastWrite : 0; }
+        bool seek(const size_t pos)
+        {
+            if (!_data || (pos > _data->content.size()))
+                return false;
+            _pos = pos;
+            return true;
+        }
+        size_t read(uint8_t *buf, size_t len)
+        {
+            if (!_data || (_pos >= _data->content.size()))
+                return 0;
+            if (len > (_data->content.size() - _pos))
+                len = _data->content.size() - _pos;
+            memcpy(buf, &_data->content[_pos], len);
+            _pos += len;
+            return len;
+        }
+        int read()
+        {
+            uint8_t c;
+            return (1 == read(&c, 1)) ? c : -1;
+        }
+        size_t write(const uint8_t *buf, const size_t len)
+        {
+            if (!_data || !_writable)
+                return 0;
+            _data->content.replace(_pos, len, (const char *)buf, len);
+            _pos += len;
+            _data->lastWrite = shimFileTime;
+            return len;
+        }
+        void flush() {}
+        void close() { _data.reset(); }
+    };
+
+    class FS
+    {
+    private:
+        std::map<std::string, std::shared_ptr<FileData>> _files;
+
+    public:
+        bool begin() { return true; }
+        void end() {}
+        /** @param mode "r", "w" or "a" */
+        File open(const String &path, const char *mode)
+        {
+            auto found = _files.find(path.c_str());
+            if ('r' == mode[0])
+                return (_files.end() == found) ? File() : File(found->second, 0, false);
+            if ((_files.end() == found) || ('w' == mode[0]))
+            {
+                std::shared_ptr<FileData> data = std::make_shared<FileData>();
+                data->lastWrite = shimFileTime;
+                found = _files.insert_or_assign(path.c_str(), data).first;
+            }
+            return File(found->second, found->second->content.size(), true);
+        }
+        bool exists(const String &path) const { return _files.end() != _files.find(path.c_str()); }
+        bool remove(const String &path) { return 0 < _files.erase(path.c_str()); }
+        bool rename(const String &from, const String &to)
+        {
+            auto found = _files.find(from.c_str());
+            if (_files.end() == found)
+                return false;
+            _files[to.c_str()] = found->second;
+            _files.erase(found);
+            return true;
+        }
+        /** For tests: replaces content of the file at once. */
+        void put(const String &path, const std::string &content)
+        {
+            File file = open(path, "w");
+            file.write((const uint8_t *)content.data(), content.size());
+        }
+    };
+} // namespace fs
+
+using fs::File;
+extern fs::FS SPIFFS;
+#endif
@@ -0,0 +1,44 @@
+/*
+Shim of the Streaming library (operator<< for Print) for host builds, see test/Makefile.
+*/
+#ifndef STREAMING_SHIM_H
+#define STREAMING_SHIM_H
+#include "Arduino.h"
+
+template <class T>
+inline Print &operator<<(Print &obj, const T &arg)
+{
+    obj.print(arg);
+    return obj;
+}
+// string literals arrive as arrays, print them as strings
+inline Print &operator<<(Print &obj, const char *arg)
+{
+    obj.print(arg);
+    return obj;
+}
+
+enum _EndLineCode
+{
+    endl
+};
+inline Print &operator<<(Print &obj, _EndLineCode)
+{
+    obj.println();
+    return obj;
+}
+
+struct _WIDTH_t
+{
+    unsigned long value;
+    int width;
+};
+#define _WIDTH(a, w) (_WIDTH_t{(unsigned long)(a), (w)})
+inline Print &operator<<(Print &obj, const _WIDTH_t &arg)
+{
+    char text[24];
+    snprintf(text, sizeof(text), "%*lu", arg.width, arg.value);
+    obj.print(text);
+    return obj;
+}
+#endif
@@ -0,0 +1 @@
+// project specific debug settings, empty for host builds
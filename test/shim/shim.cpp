@@ -0,0 +1,8 @@
+// globals of the Arduino shim, linked into every host test, see test/Makefile
+#include "Arduino.h"
+#include "FS.h"
+
+unsigned long shimMillis = 0;
+time_t shimFileTime = 0;
+HardwareSerial Serial;
+fs::FS SPIFFS;
@@ -0,0 +1,65 @@
+/*
+Minimal subset of the Unity test framework (https://github.com/ThrowTheSwitch/Unity) for host builds, see test/Makefile.
+Same macros, so the tests also run with PlatformIO's Unity.
+*/
+#ifndef UNITY_SHIM_H
+#define UNITY_SHIM_H
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+void setUp();
+void tearDown();
+
+static jmp_buf unityAbort;
+static int unityTests = 0;
+static int unityFailures = 0;
+static const char *unityCurrentTest = "";
+
+static inline void unityFail(const char *file, const int line, const char *message)
+{
+    printf("%s:%d:%s:FAIL: %s\n", file, line, unityCurrentTest, message);
+    ++unityFailures;
+    longjmp(unityAbort, 1);
+}
+
+static inline void unityAssertEqualString(const char *expected, const char *actual, const char *file, const int line)
+{
+    if ((nullptr != expected) && (nullptr != actual) && (0 == strcmp(expected, actual)))
+        return;
+    char message[512];
+    snprintf(message, sizeof(message), "Expected \"%s\" Was \"%s\"", (nullptr != expected) ? expected : "NULL", (nullptr != actual) ? actual : "NULL");
+    unityFail(file, line, message);
+}
+
+static inline void unityAssertEqualInt(const long long expected, const long long actual, const char *file, const int line)
+{
+    if (expected == actual)
+        return;
+    char message[96];
+    snprintf(message, sizeof(message), "Expected %lld Was %lld", expected, actual);
+    unityFail(file, line, message);
+}
+
+static inline void unityRun(void (*test)(), const char *name)
+{
+    unityCurrentTest = name;
+    ++unityTests;
+    if (0 == setjmp(unityAbort))
+    {
+        setUp();
+        test();
+        printf("%s:PASS\n", name);
+    }
+    tearDown();
+}
+
+#define UNITY_BEGIN() (unityTests = unityFailures = 0)
+#define UNITY_END() (printf("-----------------------\n%d Tests %d Failures\n%s\n", unityTests, unityFailures, (0 == unityFailures) ? "OK" : "FAIL"), unityFailures)
+#define RUN_TEST(func) unityRun(func, #func)
+#define TEST_FAIL_MESSAGE(message) unityFail(__FILE__, __LINE__, (message))
+#define TEST_ASSERT_TRUE(condition) ((condition) ? (void)0 : unityFail(__FILE__, __LINE__, "Expected TRUE: " #condition))
+#define TEST_ASSERT_FALSE(condition) ((condition) ? unityFail(__FILE__, __LINE__, "Expected FALSE: " #condition) : (void)0)
+#define TEST_ASSERT_EQUAL(expected, actual) unityAssertEqualInt((long long)(expected), (long long)(actual), __FILE__, __LINE__)
+#define TEST_ASSERT_EQUAL_STRING(expected, actual) unityAssertEqualString((expected), (actual), __FILE__, __LINE__)
+#endif
@@ -0,0 +1,4 @@
+// settings for host builds, see universalUIsettings.h_sample
+#ifndef UNIVERSAL_UI_SETTINGS_H
+#define UNIVERSAL_UI_SETTINGS_H
+#endif
@@ -0,0 +1,63 @@
+#include <unity.h>
+#include "appendBuffer.h"
+
+void setUp() {}
+void tearDown() {}
+
+void truncatesAtCapacity()
+{
+    StaticAppendBuffer<8> buf;
+    buf.write("abcd");
+    buf.append_P(F("efghij"));
+    TEST_ASSERT_EQUAL_STRING("abcdefg", buf.c_str());
+    TEST_ASSERT_EQUAL(7, buf.size());
+    TEST_ASSERT_EQUAL(0, buf.write('x'));
+    buf.reset();
+    TEST_ASSERT_EQUAL_STRING("", buf.c_str());
+}
+void formatsNumbers()
+{
+    StaticAppendBuffer<64> buf;
+    buf.appendUInt(4294967295u);
+    buf.write(' ');
+    buf.appendInt(-2147483647 - 1);
+    buf.write(' ');
+    buf.appendPadded(7, 3);
+    buf.write(' ');
+    buf.appendFixed(-2315, 2);
+    buf.write(' ');
+    buf.appendFixed(5, 3);
+    buf.write(' ');
+    buf.appendHex(0xBEEF, 6);
+    TEST_ASSERT_EQUAL_STRING("4294967295 -2147483648 007 -23.15 0.005 00BEEF", buf.c_str());
+    char digits[UINT32_DIGITS + 1];
+    TEST_ASSERT_EQUAL(1, AppendBuffer::formatUInt(digits, 0) - digits);
+    TEST_ASSERT_EQUAL_STRING("0", digits);
+}
+void printfIsTruncated()
+{
+    StaticAppendBuffer<8> buf;
+    TEST_ASSERT_EQUAL_STRING("12 abcd", buf.format(PSTR("%d %s"), 12, "abcdef"));
+    TEST_ASSERT_EQUAL(7, buf.size());
+}
+void viewAndMove()
+{
+    StaticAppendBuffer<16> buf;
+    buf.write("hello world");
+    const AppendBufferView slice = buf.view().slice(6, 100);
+    TEST_ASSERT_EQUAL(5, slice.length());
+    TEST_ASSERT_EQUAL(0, memcmp("world", slice.data(), 5));
+    StaticAppendBuffer<16> moved(std::move(buf));
+    TEST_ASSERT_EQUAL_STRING("hello world", moved.c_str());
+    TEST_ASSERT_EQUAL_STRING("", buf.c_str());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(truncatesAtCapacity);
+    RUN_TEST(formatsNumbers);
+    RUN_TEST(printfIsTruncated);
+    RUN_TEST(viewAndMove);
+    return UNITY_END();
+}
@@ -0,0 +1,189 @@
+#include <unity.h>
+#include <string>
+#include "ESPAsyncWebServer.h"
+#include "gzipDataSource.h"
+
+void setUp() {}
+void tearDown() {}
+
+/** Delivers content in small pieces, every third call "try again", like a template waiting for its placeholders. */
+class PieceDataSource : public AwsResponseDataSource
+{
+private:
+    const std::string _content;
+    int _calls = 0;
+
+public:
+    PieceDataSource(const std::string &content) : _content(content) {}
+    virtual size_t fillBuffer(uint8_t *buf, size_t maxLen, size_t index)
+    {
+        if (0 == (++_calls % 3))
+            return RESPONSE_TRY_AGAIN;
+        size_t len = (index < _content.size()) ? _content.size() - index : 0;
+        if (len > maxLen)
+            len = maxLen;
+        if (len > 7)
+            len = 7;
+        memcpy(buf, &_content[index], len);
+        return len;
+    }
+};
+
+/** @return complete response of source, maxLen bytes per call */
+std::string respond(AwsResponseDataSource &source, const size_t maxLen)
+{
+    std::string content;
+    uint8_t buf[2048];
+    size_t len;
+    size_t index = 0;
+    while ((len = source.fillBuffer(buf, maxLen, index)) > 0)
+    {
+        if (RESPONSE_TRY_AGAIN == len)
+            continue;
+        TEST_ASSERT_TRUE(len <= maxLen);
+        content.append((const char *)buf, len);
+        index += len;
+    }
+    return content;
+}
+
+/** Reads a gzip stream with a single deflate block of fixed Huffman codes, like GzipResponseDataSource writes it. */
+class Inflater
+{
+private:
+    const std::string &_in;
+    size_t _pos = 10; // behind gzip header
+    uint8_t _bit = 0;
+
+    uint32_t bits(const uint8_t count)
+    {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            TEST_ASSERT_TRUE(_pos < _in.size());
+            value |= (uint32_t)(((uint8_t)_in[_pos] >> _bit) & 1) << i;
+            if (8 == ++_bit)
+            {
+                _bit = 0;
+                ++_pos;
+            }
+        }
+        return value;
+    }
+    /** Huffman codes are stored starting with the most significant bit. */
+    uint32_t code(uint32_t value, uint8_t count)
+    {
+        for (; count > 0; --count)
+            value = (value << 1) | bits(1);
+        return value;
+    }
+    uint16_t symbol()
+    {
+        uint32_t c = code(0, 7);
+        if (c <= 0x17)
+            return 256 + c;
+        c = code(c, 1);
+        if ((c >= 0x30) && (c <= 0xBF))
+            return c - 0x30;
+        if ((c >= 0xC0) && (c <= 0xC7))
+            return 280 + c - 0xC0;
+        return 144 + code(c, 1) - 0x190;
+    }
+
+public:
+    Inflater(const std::string &in) : _in(in) {}
+
+    /** @return inflated content, the trailer is checked against it */
+    std::string inflate()
+    {
+        static const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const uint16_t distBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        TEST_ASSERT_TRUE(_in.size() >= 18);
+        TEST_ASSERT_EQUAL(0x1F, (uint8_t)_in[0]);
+        TEST_ASSERT_EQUAL(0x8B, (uint8_t)_in[1]);
+        TEST_ASSERT_EQUAL(8, _in[2]); // deflate
+        TEST_ASSERT_EQUAL(1, bits(1)); // final block
+        TEST_ASSERT_EQUAL(1, bits(2)); // fixed Huffman codes
+        std::string out;
+        for (uint16_t sym = symbol(); 256 != sym; sym = symbol())
+        {
+            if (sym < 256)
+            {
+                out += (char)sym;
+                continue;
+            }
+            sym -= 257;
+            TEST_ASSERT_TRUE(sym < 29);
+            const size_t len = lengthBase[sym] + bits(((sym < 8) || (28 == sym)) ? 0 : (sym - 4) / 4);
+            const uint8_t distCode = code(0, 5);
+            TEST_ASSERT_TRUE(distCode < 30);
+            const size_t dist = distBase[distCode] + bits((distCode < 4) ? 0 : (distCode - 2) / 2);
+            TEST_ASSERT_TRUE(dist <= out.size());
+            for (size_t i = 0; i < len; ++i)
+                out += out[out.size() - dist];
+        }
+        if (0 != _bit)
+            ++_pos;
+        TEST_ASSERT_EQUAL(_in.size(), _pos + 8);
+        TEST_ASSERT_EQUAL(crc32(out), trailer(0));
+        TEST_ASSERT_EQUAL(out.size(), trailer(4));
+        return out;
+    }
+    uint32_t trailer(const size_t offset) const
+    {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < 4; ++i)
+            value |= (uint32_t)(uint8_t)_in[_pos + offset + i] << (8 * i);
+        return value;
+    }
+    static uint32_t crc32(const std::string &content)
+    {
+        uint32_t crc = 0xFFFFFFFF;
+        for (const char c : content)
+        {
+            crc ^= (uint8_t)c;
+            for (uint8_t i = 0; i < 8; ++i)
+                crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+        return crc ^ 0xFFFFFFFF;
+    }
+};
+
+/** Log-like content: repetitions near and beyond the window, long runs and characters with 9 bit codes. */
+std::string sampleContent()
+{
+    std::string content;
+    for (int i = 0; i < 60; ++i)
+        content += "   " + std::to_string(1000 + 37 * i) + "   INFO  \tmeasured " + std::to_string(i % 7) + " \xC2\xB0" + "C\n";
+    content += std::string(600, '-') + "\n";
+    for (int i = 0; i < 256; ++i)
+        content += (char)i;
+    return content;
+}
+
+void emptyContent()
+{
+    GzipResponseDataSource gzip(new PieceDataSource(""));
+    const std::string compressed = respond(gzip, 64);
+    TEST_ASSERT_EQUAL_STRING("", Inflater(compressed).inflate().c_str());
+}
+void inflatesForAnyMaxLen()
+{
+    const std::string content = sampleContent();
+    const size_t maxLens[] = {GZIP_MIN_SPACE, GZIP_MIN_SPACE + 1, 50, 100, 257, 1460, 2048};
+    for (const size_t maxLen : maxLens)
+    {
+        GzipResponseDataSource gzip(new PieceDataSource(content));
+        const std::string compressed = respond(gzip, maxLen);
+        TEST_ASSERT_TRUE(compressed.size() < content.size());
+        TEST_ASSERT_TRUE(content == Inflater(compressed).inflate());
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(emptyContent);
+    RUN_TEST(inflatesForAnyMaxLen);
+    return UNITY_END();
+}
@@ -0,0 +1,276 @@
+#include <unity.h>
+#include <string>
+#include "ESPAsyncWebServer.h"
+#include "logBuffer.h"
+
+// scenarios of testLogBuffer.feature: size of log buffer is 16 characters
+LogBuffer lb = LogBuffer(16);
+
+void setUp()
+{
+    lb.clear();
+}
+void tearDown() {}
+
+/** @return content copied by getLog(char *, size_t) */
+std::string copiedLog(LogBuffer &log)
+{
+    char buf[256];
+    TEST_ASSERT_TRUE(log.getLog(buf, sizeof(buf)) < sizeof(buf));
+    return buf;
+}
+/** @return content delivered by the chunked getLog(), maxLen bytes per call */
+std::string chunkedLog(LogBuffer &log, const size_t maxLen, const bool rawPercent = true)
+{
+    LogReadState state;
+    state.rawPercent = rawPercent;
+    std::string content;
+    uint8_t buf[256];
+    size_t len;
+    for (size_t index = 0; (len = log.getLog(buf, maxLen, index, state)) > 0; index += len)
+    {
+        TEST_ASSERT_TRUE(len <= maxLen);
+        content.append((const char *)buf, len);
+    }
+    return content;
+}
+
+void emptyBuffer()
+{
+    lb.write("");
+    TEST_ASSERT_EQUAL_STRING("", copiedLog(lb).c_str());
+    TEST_ASSERT_EQUAL_STRING("", chunkedLog(lb, 64).c_str());
+}
+void simpleLogging()
+{
+    lb.write("abcd");
+    lb.write("xyz");
+    TEST_ASSERT_EQUAL_STRING("abcdxyz", copiedLog(lb).c_str());
+    TEST_ASSERT_EQUAL_STRING("abcdxyz", chunkedLog(lb, 64).c_str());
+}
+void messageLargerThanBuffer()
+{
+    lb.write("123456789012345678");
+    TEST_ASSERT_EQUAL_STRING("[...] 456789012345678", copiedLog(lb).c_str());
+    TEST_ASSERT_EQUAL_STRING("[...] 456789012345678", chunkedLog(lb, 64).c_str());
+}
+void rollOverOfBuffer()
+{
+    lb.write("1234567890");
+    lb.write("abcdefghij");
+    TEST_ASSERT_EQUAL_STRING("[...] 67890abcdefghij", copiedLog(lb).c_str());
+    TEST_ASSERT_EQUAL_STRING("[...] 67890abcdefghij", chunkedLog(lb, 64).c_str());
+}
+void printWithLineEndings()
+{
+    lb.write("123456789\n");
+    lb.write("abcde\n");
+    TEST_ASSERT_EQUAL_STRING("[...] 23456789\nabcde\n", copiedLog(lb).c_str());
+    TEST_ASSERT_EQUAL_STRING("[...] 23456789\nabcde\n", chunkedLog(lb, 64).c_str());
+}
+
+void chunkedReadAnyChunkSize()
+{
+    lb.write("1234567890");
+    lb.write("abcdefghij");
+    for (size_t maxLen = 1; maxLen <= 22; ++maxLen)
+        TEST_ASSERT_EQUAL_STRING("[...] 67890abcdefghij", chunkedLog(lb, maxLen).c_str());
+}
+void chunkedReadEncodesPercent()
+{
+    char memory[32];
+    LogBuffer log(sizeof(memory), memory, true);
+    log.write("100% of 5%");
+    for (size_t maxLen = 1; maxLen <= 14; ++maxLen)
+        TEST_ASSERT_EQUAL_STRING("100%% of 5%%", chunkedLog(log, maxLen, false).c_str());
+    TEST_ASSERT_EQUAL_STRING("100% of 5%", chunkedLog(log, 64, true).c_str());
+    TEST_ASSERT_EQUAL_STRING("100%% of 5%%", copiedLog(log).c_str());
+}
+void copyEncodesPercentOfFullRing()
+{
+    char memory[17];
+    LogBuffer log(sizeof(memory), memory, true);
+    log.write("%%%%%%%%%%%%%%%%%%");
+    TEST_ASSERT_EQUAL_STRING("[...] %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%", copiedLog(log).c_str());
+}
+void chunkedReadTryAgainOnlyIfContent()
+{
+    LogReadState state;
+    uint8_t buf[8];
+    TEST_ASSERT_EQUAL(0, lb.getLog(buf, 0, 0, state));
+    lb.write("abc");
+    TEST_ASSERT_EQUAL(RESPONSE_TRY_AGAIN, lb.getLog(buf, 0, 0, state));
+}
+void chunkedReadOverrunResyncsAtLine()
+{
+    char memory[33];
+    LogBuffer log(sizeof(memory), memory);
+    log.write("line1\nline2\n");
+    LogReadState state;
+    state.rawPercent = true;
+    uint8_t buf[64];
+    TEST_ASSERT_EQUAL(3, log.getLog(buf, 3, 0, state));
+    log.write("line3\nline4\nline5\nline6\n");
+    const size_t len = log.readLog(buf, sizeof(buf), state);
+    // content logged after beginRead() is not part of this read
+    TEST_ASSERT_EQUAL_STRING("[...] line2\n", std::string((const char *)buf, len).c_str());
+}
+
+size_t formatLevel(const LogRecord &record, char *text, size_t maxTextLen)
+{
+    return snprintf(text, maxTextLen, "%lu L%u ", (unsigned long)record.millis, record.level);
+}
+void recordsAreFormattedAtReadTime()
+{
+    char memory[64];
+    LogBuffer log(sizeof(memory), memory);
+    log.setRecordFormatter(formatLevel);
+    log.writeRecord({1234, 0, 3});
+    log.write("first\n");
+    log.writeRecord({200000, 0, 1});
+    log.write("second\n");
+    for (size_t maxLen = 1; maxLen <= 40; ++maxLen)
+        TEST_ASSERT_EQUAL_STRING("1234 L3 first\n200000 L1 second\n", chunkedLog(log, maxLen).c_str());
+    TEST_ASSERT_EQUAL_STRING("1234 L3 first\n200000 L1 second\n", copiedLog(log).c_str());
+}
+size_t formatLong(const LogRecord &record, char *text, size_t maxTextLen)
+{
+    return snprintf(text, maxTextLen, "record %08lu L%u: ", (unsigned long)record.millis, record.level);
+}
+void formattedCopyLargerThanRing()
+{
+    char memory[32];
+    LogBuffer log(sizeof(memory), memory);
+    log.setRecordFormatter(formatLong);
+    log.writeRecord({1, 0, 3});
+    log.write("a\n");
+    log.writeRecord({2, 0, 3});
+    log.write("b\n");
+    TEST_ASSERT_EQUAL_STRING("record 00000001 L3: a\nrecord 00000002 L3: b\n", copiedLog(log).c_str());
+}
+void copyIsTruncatedToBuffer()
+{
+    lb.write("123456789012345678");
+    char buf[10];
+    TEST_ASSERT_EQUAL(21, lb.getLog(buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("[...] 456", buf);
+    TEST_ASSERT_EQUAL(21, lb.getLog(buf, 0));
+}
+
+void sinceReadsOnlyNewContent()
+{
+    lb.write("old\n");
+    LogReadState state;
+    state.rawPercent = true;
+    const size_t since = lb.beginRead(state);
+    lb.write("new\n");
+    uint8_t buf[32];
+    TEST_ASSERT_EQUAL(4, lb.getLogSince(since, buf, sizeof(buf), 0, state));
+    TEST_ASSERT_EQUAL_STRING("new\n", std::string((const char *)buf, 4).c_str());
+}
+/** @return content of a merged read of logs after since, maxLen bytes per call */
+std::string mergedLog(LogBuffer *const *logs, const LogMergeSeq &since, const size_t maxLen)
+{
+    LogMergeReadState state;
+    state.rawPercent = true;
+    beginMergedRead(logs, 2, state, since);
+    std::string content;
+    uint8_t buf[64];
+    size_t len;
+    while ((len = readMergedLog(logs, 2, buf, maxLen, state)) > 0)
+        content.append((const char *)buf, len);
+    return content;
+}
+void mergedSinceReadsOnlyNewContent()
+{
+    char mainMemory[64], alertMemory[64];
+    LogBuffer mainLog(sizeof(mainMemory), mainMemory), alertLog(sizeof(alertMemory), alertMemory);
+    mainLog.setRecordFormatter(formatLevel);
+    alertLog.setRecordFormatter(formatLevel);
+    LogBuffer *const logs[] = {&mainLog, &alertLog};
+    mainLog.writeRecord({1, 0, 3});
+    mainLog.write("old\n");
+    const LogMergeSeq since = getMergedSeq(logs, 2);
+    alertLog.writeRecord({3, 0, 1});
+    alertLog.write("error\n");
+    mainLog.writeRecord({2, 0, 3});
+    mainLog.write("new\n");
+    for (size_t maxLen = 1; maxLen <= 40; ++maxLen)
+    {
+        TEST_ASSERT_EQUAL_STRING("2 L3 new\n3 L1 error\n", mergedLog(logs, since, maxLen).c_str());
+        TEST_ASSERT_EQUAL_STRING("1 L3 old\n2 L3 new\n3 L1 error\n", mergedLog(logs, LogMergeSeq(), maxLen).c_str());
+    }
+}
+void sinceKeepsMultibyteCharacters()
+{
+    LogReadState state;
+    state.rawPercent = true;
+    const size_t since = lb.beginRead(state);
+    lb.print("\xC3\xA4rger\n");
+    uint8_t buf[32];
+    TEST_ASSERT_EQUAL(7, lb.getLogSince(since, buf, sizeof(buf), 0, state));
+    TEST_ASSERT_EQUAL_STRING("\xC3\xA4rger\n", std::string((const char *)buf, 7).c_str());
+}
+void resyncKeepsMultibyteCharacters()
+{
+    char memory[33];
+    LogBuffer log(sizeof(memory), memory);
+    log.write("line1\n\xC3\xA4ne2\n");
+    LogReadState state;
+    state.rawPercent = true;
+    uint8_t buf[64];
+    TEST_ASSERT_EQUAL(3, log.getLog(buf, 3, 0, state));
+    log.write("line3\nline4\nline5\nline6\n");
+    const size_t len = log.readLog(buf, sizeof(buf), state);
+    TEST_ASSERT_EQUAL_STRING("[...] \xC3\xA4ne2\n", std::string((const char *)buf, len).c_str());
+}
+void followContinuesCursor()
+{
+    LogReadState state;
+    state.rawPercent = true;
+    lb.beginRead(state);
+    uint8_t buf[32];
+    lb.print("T=21");
+    size_t len = lb.readFollow(buf, sizeof(buf), state);
+    lb.print("\xC2\xB0" "C\n");
+    len += lb.readFollow(&buf[len], sizeof(buf) - len, state);
+    TEST_ASSERT_EQUAL(0, lb.readFollow(&buf[len], sizeof(buf) - len, state));
+    TEST_ASSERT_EQUAL_STRING("T=21\xC2\xB0" "C\n", std::string((const char *)buf, len).c_str());
+}
+void followResyncsAfterOverrun()
+{
+    LogReadState state;
+    state.rawPercent = true;
+    lb.beginRead(state);
+    uint8_t buf[32];
+    lb.write("a\n");
+    size_t len = lb.readFollow(buf, sizeof(buf), state);
+    lb.write("0123456789\nwxyz\n");
+    len += lb.readFollow(&buf[len], sizeof(buf) - len, state);
+    TEST_ASSERT_EQUAL_STRING("a\n[...] wxyz\n", std::string((const char *)buf, len).c_str());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(emptyBuffer);
+    RUN_TEST(simpleLogging);
+    RUN_TEST(messageLargerThanBuffer);
+    RUN_TEST(rollOverOfBuffer);
+    RUN_TEST(printWithLineEndings);
+    RUN_TEST(chunkedReadAnyChunkSize);
+    RUN_TEST(chunkedReadEncodesPercent);
+    RUN_TEST(copyEncodesPercentOfFullRing);
+    RUN_TEST(chunkedReadTryAgainOnlyIfContent);
+    RUN_TEST(chunkedReadOverrunResyncsAtLine);
+    RUN_TEST(recordsAreFormattedAtReadTime);
+    RUN_TEST(formattedCopyLargerThanRing);
+    RUN_TEST(copyIsTruncatedToBuffer);
+    RUN_TEST(sinceReadsOnlyNewContent);
+    RUN_TEST(mergedSinceReadsOnlyNewContent);
+    RUN_TEST(sinceKeepsMultibyteCharacters);
+    RUN_TEST(resyncKeepsMultibyteCharacters);
+    RUN_TEST(followContinuesCursor);
+    RUN_TEST(followResyncsAfterOverrun);
+    return UNITY_END();
+}
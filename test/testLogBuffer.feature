@@ -15,15 +15,18 @@ Feature: log buffer
     Scenario: message larger than buf
         Given log buf is filled with ""
         When message "123456789012345678" is appended
-        Then getLog() returns "[...] 9012345678"
+        Then getLog() returns "[...] 456789012345678"
+        And chunked getLog() returns "[...] 456789012345678"
 
     Scenario: roll-over of buffer
         Given log buf is filled with "1234567890"
         When message "abcdefghij" is appended
         # note: '5' is replaced by terminating \0 of message resulting in only 15 chars
-        Then getLog() returns "67890abcdefghij"
+        Then getLog() returns "[...] 67890abcdefghij"
+        And chunked getLog() with any maxLen returns "[...] 67890abcdefghij"
 
     Scenario: print with line endings
         Given log buf is filled with "123456789\n"
         When message "abcde\n" is appended
-        Then getLog() returns "123456789\nabcde\n"
+        # note: 16 characters exceed the 15 characters kept
+        Then getLog() returns "[...] 23456789\nabcde\n"
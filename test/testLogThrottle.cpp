@@ -0,0 +1,80 @@
+#include <unity.h>
+#include <string>
+#include <Streaming.h>
+#include "ESPAsyncWebServer.h"
+#include "logThrottle.h"
+
+char memory[256];
+LogBuffer lb = LogBuffer(sizeof(memory), memory);
+
+void setUp()
+{
+    lb.clear();
+    shimMillis = 0;
+}
+void tearDown() {}
+
+std::string content()
+{
+    char buf[sizeof(memory)];
+    lb.getLog(buf, sizeof(buf));
+    return buf;
+}
+
+size_t formatPrefix(const LogRecord &record, char *text, size_t maxTextLen)
+{
+    return snprintf(text, maxTextLen, "%lu ", (unsigned long)record.millis);
+}
+
+/** @return number of entries logged by the rate limited call site */
+int logRateLimited(const bool condition)
+{
+    int logged = 0;
+    if (condition)
+        UNIVERSALUI_RATE_LIMITED(2, 1000) ++logged;
+    else
+        logged = -1;
+    return logged;
+}
+void rateLimitedIsSingleStatement()
+{
+    TEST_ASSERT_EQUAL(-1, logRateLimited(false));
+    TEST_ASSERT_EQUAL(1, logRateLimited(true));
+    TEST_ASSERT_EQUAL(1, logRateLimited(true));
+    TEST_ASSERT_EQUAL(0, logRateLimited(true));
+    shimMillis = 500;
+    TEST_ASSERT_EQUAL(1, logRateLimited(true));
+}
+void repeatedEntriesAreCounted()
+{
+    LogCoalescer coalescer(formatPrefix);
+    for (uint32_t ms = 1; ms <= 3; ++ms)
+        coalescer.begin(lb, {ms, 0, 3}) << "same" << endl;
+    coalescer.begin(lb, {4, 0, 3}) << "other" << endl;
+    TEST_ASSERT_EQUAL_STRING("1 same\r\n3 last message repeated 2 times\n4 other\r\n", content().c_str());
+}
+void stagedEntriesAreNotCoalesced()
+{
+    LogCoalescer stage(formatPrefix, false);
+    stage.begin(lb, {1, 0, 3}) << "same" << endl;
+    stage.begin(lb, {2, 0, 3}) << "sa";
+    stage << "me" << endl;
+    TEST_ASSERT_EQUAL_STRING("1 same\r\n2 same\r\n", content().c_str());
+}
+void entryWithoutTextIsDropped()
+{
+    LogCoalescer stage(formatPrefix, false);
+    stage.begin(lb, {1, 0, 3});
+    stage.begin(lb, {2, 0, 3}) << "text" << endl;
+    TEST_ASSERT_EQUAL_STRING("2 text\r\n", content().c_str());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(rateLimitedIsSingleStatement);
+    RUN_TEST(repeatedEntriesAreCounted);
+    RUN_TEST(stagedEntriesAreNotCoalesced);
+    RUN_TEST(entryWithoutTextIsDropped);
+    return UNITY_END();
+}
@@ -0,0 +1,139 @@
+#define LOGBUF_LENGTH 1024
+#include <unity.h>
+#include <string>
+#include "ESPAsyncWebServer.h"
+#include "webUiGenericPlaceHolder.h"
+
+UniversalUI ui = UniversalUI("test");
+
+const char *const TEMPLATE = "<h1>%NAME%</h1>%%<pre>$LOG$</pre>$NOPE$ $COUNT$ %UNTERMINATED";
+
+void setUp() {}
+void tearDown() {}
+
+size_t printName(const char *var, Print &out)
+{
+    return (0 == strcmp("NAME", var)) ? out.print("value") : out.print("?");
+}
+size_t printBig(const char *, Print &out)
+{
+    size_t len = 0;
+    for (int i = 0; i < 300; ++i)
+        len += out.write('x');
+    return len;
+}
+size_t fillCount(uint8_t *buf, size_t maxLen, size_t index)
+{
+    const char *const count = "0123456789";
+    size_t len = (index < strlen(count)) ? strlen(count) - index : 0;
+    if (len > maxLen)
+        len = maxLen;
+    memcpy(buf, &count[index], len);
+    return len;
+}
+
+/** @return complete response of source, maxLen bytes per call */
+std::string respond(AwsResponseDataSource &source, const size_t maxLen)
+{
+    std::string content;
+    uint8_t buf[512];
+    size_t len;
+    for (size_t index = 0; (len = source.fillBuffer(buf, maxLen, index)) > 0; index += len)
+    {
+        TEST_ASSERT_TRUE(len <= maxLen);
+        content.append((const char *)buf, len);
+    }
+    return content;
+}
+/** @return log content as delivered by "$LOG$" */
+std::string htmlLog(const bool rawPercent)
+{
+    LogReadState state;
+    state.rawPercent = rawPercent;
+    std::string content;
+    uint8_t buf[256];
+    size_t len;
+    for (size_t index = 0; (len = ui.getHtmlLog(buf, sizeof(buf), index, state)) > 0; index += len)
+        content.append((const char *)buf, len);
+    return content;
+}
+std::string expected(const bool rawPercent)
+{
+    return "<h1>value</h1>%<pre>" + htmlLog(rawPercent) + "</pre>$NOPE$ 0123456789 %UNTERMINATED";
+}
+
+void templateAnyChunkSize()
+{
+    for (size_t maxLen = 1; maxLen <= 100; ++maxLen)
+    {
+        TemplateResponseDataSource source(SPIFFS, "/t.html", printName);
+        TEST_ASSERT_EQUAL_STRING(expected(true).c_str(), respond(source, maxLen).c_str());
+    }
+}
+void cachedTemplateAnyChunkSize()
+{
+    TEST_ASSERT_TRUE(cacheTemplate(SPIFFS, "/c.html"));
+    for (size_t maxLen = 1; maxLen <= 100; ++maxLen)
+    {
+        TemplateResponseDataSource source(SPIFFS, "/c.html", printName);
+        TEST_ASSERT_EQUAL_STRING(expected(true).c_str(), respond(source, maxLen).c_str());
+    }
+}
+void fileWithLogBufferLeavesPlaceholders()
+{
+    const std::string expectedContent = std::string("<h1>%NAME%</h1>%%<pre>") + htmlLog(false) + "</pre>$NOPE$ 0123456789 %UNTERMINATED";
+    TEST_ASSERT_TRUE(std::string::npos != expectedContent.find("50%% done"));
+    for (size_t maxLen = 1; maxLen <= 100; ++maxLen)
+    {
+        FileWithLogBufferResponseDataSource source(SPIFFS, "/t.html");
+        TEST_ASSERT_EQUAL_STRING(expectedContent.c_str(), respond(source, maxLen).c_str());
+    }
+}
+void placeholderHashCollision()
+{
+    TEST_ASSERT_EQUAL(placeholderHash("LQNQX"), placeholderHash("ZAORB"));
+    TEST_ASSERT_TRUE(registerPlaceholder("LQNQX", printName));
+    StaticAppendBuffer<16> buf;
+    universalUiPlaceholderPrinter("ZAORB", buf);
+    TEST_ASSERT_EQUAL_STRING("???", buf.c_str());
+    buf.reset();
+    universalUiPlaceholderPrinter("LQNQX", buf);
+    TEST_ASSERT_EQUAL_STRING("?", buf.c_str());
+}
+void truncatedPlaceholderIsLogged()
+{
+    TEST_ASSERT_TRUE(registerPlaceholder("BIG", printBig));
+    TemplateResponseDataSource source(SPIFFS, "/b.html", universalUiPlaceholderPrinter);
+    TEST_ASSERT_EQUAL(16 + UNIVERSALUI_PLACEHOLDER_OVERFLOW, respond(source, 16).length());
+    TEST_ASSERT_TRUE(std::string::npos != htmlLog(true).find("output of placeholder BIG truncated by 28 bytes"));
+}
+void rewrittenTemplateIsNotCached()
+{
+    SPIFFS.put("/m.html", "%NAME%abc");
+    TEST_ASSERT_TRUE(cacheTemplate(SPIFFS, "/m.html"));
+    ++shimFileTime;
+    SPIFFS.put("/m.html", "abc%NAME%");
+    TemplateResponseDataSource modified(SPIFFS, "/m.html", printName);
+    TEST_ASSERT_EQUAL_STRING("abcvalue", respond(modified, 100).c_str());
+    SPIFFS.put("/m.html", "%NAME%abc"); // same size and time
+    invalidateTemplateCache();
+    TemplateResponseDataSource invalidated(SPIFFS, "/m.html", printName);
+    TEST_ASSERT_EQUAL_STRING("valueabc", respond(invalidated, 100).c_str());
+}
+
+int main()
+{
+    SPIFFS.put("/t.html", TEMPLATE);
+    SPIFFS.put("/c.html", TEMPLATE);
+    SPIFFS.put("/b.html", "%BIG%");
+    registerStreamingPlaceholder("COUNT", fillCount);
+    ui.logInfo() << "50% done" << endl;
+    UNITY_BEGIN();
+    RUN_TEST(templateAnyChunkSize);
+    RUN_TEST(cachedTemplateAnyChunkSize);
+    RUN_TEST(fileWithLogBufferLeavesPlaceholders);
+    RUN_TEST(placeholderHashCollision);
+    RUN_TEST(truncatedPlaceholderIsLogged);
+    RUN_TEST(rewrittenTemplateIsNotCached);
+    return UNITY_END();
+}
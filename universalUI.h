@@ -15,9 +15,16 @@ You should have received a copy of the GNU General Public License along with thi
 
 #include <Arduino.h>
 #include <Streaming.h>
-#include <NTPClient.h>
 #include <Print.h>
-#if defined(ESP32) // ESP32 board
+#if defined(UNIVERSALUI_NO_WIFI) && !defined(UNIVERSALUI_NO_NTP)
+#define UNIVERSALUI_NO_NTP // NTP needs the network
+#endif
+#ifndef UNIVERSALUI_NO_NTP
+#include <NTPClient.h>
+#endif
+#if defined(UNIVERSALUI_NO_WIFI)
+// neither WiFi, mDNS, OTA nor filesystem
+#elif defined(ESP32) // ESP32 board
 #include <WiFi.h>
 #include <ESPmDNS.h>
 #include <ArduinoOTA.h>
@@ -33,10 +40,22 @@ extern "C"
 #include <FS.h>
 #endif
 
-#include "universalUIsettings.h"
+#ifndef UNIVERSALUI_NO_WIFI
+#include "universalUIsettings.h" // before logBuffer.h, it may configure COPY_TO_SERIAL
+#endif
 #include "logBuffer.h"
+#ifndef UNIVERSALUI_NO_STATUS_LED
 #include "blinkLed.h"
+#endif
 #include "appendBuffer.h"
+#ifndef UNIVERSALUI_NO_NTP
+#include "asyncNtpClient.h"
+#endif
+#include "heapMonitor.h"
+#include "logThrottle.h"
+#ifdef UNIVERSALUI_LOG_SPILL
+#include "logSpill.h"
+#endif
 
 // configuration section, to be modified via earlier #define's
 #ifndef NTP_UPDATE_INTERVAL
@@ -56,10 +75,67 @@ extern "C"
 #ifndef UNIVERSALUI_WIFI_RECONNECT_PERIOD
 #define UNIVERSALUI_WIFI_RECONNECT_PERIOD 30000 // 30sec in [ms], time to wait between WiFi reconnect attempts
 #endif
+#ifndef UNIVERSALUI_WIFI_RECONNECT_MAX_PERIOD
+#define UNIVERSALUI_WIFI_RECONNECT_MAX_PERIOD 480000 // 8min in [ms], wait time is doubled after each failed reconnect attempt up to this value
+#endif
 
 // optional configuration settings, to be defined before including this file
 //#define UNIVERSALUI_WIFI_REBOOT_ON_FAILED_CONNECT
 //#define COPY_TO_SERIAL                    // if logged messages should be immediately printed on Serial
+//#define COPY_TO_SERIAL_NONBLOCKING        // if logged messages should be printed on Serial by handle(), only as much as the UART accepts without blocking
+//#define UNIVERSALUI_LOG_LEVEL UNIVERSALUI_LOGLEVEL_INFO // maximum log level to compile, logDebug() and logTrace() then compile to nothing
+//#define UNIVERSALUI_BINARY_LOG            // if timestamp and level of log entries should be stored in binary form, formatted only when delivered via getHtmlLog()
+//#define UNIVERSALUI_PROFILE               // if duration of handle() and critical sections should be measured, see perfProfiler.h
+//#define UNIVERSALUI_PERSISTENT_LOG        // if log should survive resets (watchdog, ESP.restart(), OTA), ESP32 only: placed in memory not initialized at boot
+//#define UNIVERSALUI_HEAP_MONITOR          // if free heap, fragmentation and stack watermark should be sampled by handle(), see heapMonitor.h
+//#define UNIVERSALUI_LOG_SPILL             // if log should be copied into rotating files by handle(), see logSpill.h and enableLogSpill()
+//#define UNIVERSALUI_ALERT_LOG_LENGTH 4096 // if errors and warnings should be kept in an own log channel of this size, taken from LOGBUF_LENGTH
+//#define UNIVERSALUI_LOG_COALESCE          // if repeated log entries should be collapsed into "last message repeated N times", see logThrottle.h
+//#define UNIVERSALUI_SERVICE_TASK          // if housekeeping of handle() should run in an own task, ESP32 only, see UNIVERSALUI_SERVICE_TASK_CORE
+//#define UNIVERSALUI_NO_WIFI               // if WiFi, OTA and NTP should not be compiled in, e.g. for nodes using logging only; init() then doesn't wait for a connection
+//#define UNIVERSALUI_NO_NTP                // if NTP should not be compiled in, timestamps of the log are based on millis()
+//#define UNIVERSALUI_NO_STATUS_LED         // if the status LED should not be compiled in, init() ignores the pin
+
+#ifdef UNIVERSALUI_SERVICE_TASK
+#if !defined(ESP32)
+#error "UNIVERSALUI_SERVICE_TASK requires FreeRTOS with two cores, supported on ESP32 only"
+#endif
+#ifdef LOGBUFFER_LOCKFREE
+#error "UNIVERSALUI_SERVICE_TASK logs from two tasks, thus can't be used with LOGBUFFER_LOCKFREE"
+#endif
+#ifndef UNIVERSALUI_SERVICE_TASK_CORE
+#define UNIVERSALUI_SERVICE_TASK_CORE 0 // core of WiFi stack, arduino loop runs on core 1
+#endif
+#ifndef UNIVERSALUI_SERVICE_TASK_PRIORITY
+#define UNIVERSALUI_SERVICE_TASK_PRIORITY 1 // same as arduino loop, below the WiFi stack
+#endif
+#ifndef UNIVERSALUI_SERVICE_TASK_STACK
+#define UNIVERSALUI_SERVICE_TASK_STACK 4096 // [bytes]
+#endif
+#ifndef UNIVERSALUI_SERVICE_TASK_INTERVAL
+#define UNIVERSALUI_SERVICE_TASK_INTERVAL 10 // [ms] between housekeeping cycles
+#endif
+// status LED and status message are changed by the arduino loop and the service task
+#define UNIVERSALUI_STATUS_LOCK portENTER_CRITICAL(&universalUI_statusMutex);
+#define UNIVERSALUI_STATUS_UNLOCK portEXIT_CRITICAL(&universalUI_statusMutex);
+static portMUX_TYPE universalUI_statusMutex = portMUX_INITIALIZER_UNLOCKED;
+// status message is a String, so it is guarded by a mutex instead of a critical section
+#include <freertos/semphr.h>
+#define UNIVERSALUI_MESSAGE_LOCK xSemaphoreTake(_statusMessageMutex, portMAX_DELAY);
+#define UNIVERSALUI_MESSAGE_UNLOCK xSemaphoreGive(_statusMessageMutex);
+#else
+#define UNIVERSALUI_STATUS_LOCK ;
+#define UNIVERSALUI_STATUS_UNLOCK ;
+#define UNIVERSALUI_MESSAGE_LOCK ;
+#define UNIVERSALUI_MESSAGE_UNLOCK ;
+#endif
+#if defined(UNIVERSALUI_LOG_COALESCE) || defined(UNIVERSALUI_SERVICE_TASK)
+#define UNIVERSALUI_LOG_STAGED // log entries are collected per task by LogCoalescer and appended at once, so entries of several tasks don't interleave
+#endif
+#define UNIVERSALUI_TIMESTAMP_SIZE 9 // "HH:MM:SS" including terminating '\0', see getTimestamp(char *)
+#ifndef UNIVERSALUI_SERIAL_CHUNK
+#define UNIVERSALUI_SERIAL_CHUNK 64 // bytes copied at once from log buffer to Serial with COPY_TO_SERIAL_NONBLOCKING
+#endif
 
 // following settings are per default adapted to default behaviour of the board
 #ifndef UNIVERSALUI_SERIAL_BAUDRATE
@@ -80,10 +156,69 @@ extern "C"
 #define LOGBUF_LENGTH 16 // default size, for testing
 #endif
 
+// log levels, as used by logError() .. logTrace()
+#define UNIVERSALUI_LOGLEVEL_ERROR 1
+#define UNIVERSALUI_LOGLEVEL_WARN 2
+#define UNIVERSALUI_LOGLEVEL_INFO 3
+#define UNIVERSALUI_LOGLEVEL_DEBUG 4
+#define UNIVERSALUI_LOGLEVEL_TRACE 5
+
+// maximum log level to compile, logging with higher levels is removed by the compiler
+#ifndef UNIVERSALUI_LOG_LEVEL
+#define UNIVERSALUI_LOG_LEVEL UNIVERSALUI_LOGLEVEL_TRACE
+#endif
+
 static const int TIME_UNIT_DIVIDER[] = {1000, 60, 60, 24, 0}; // last divider must be zero to indicate end of array
-static String TIME_UNIT_LABEL[] = {"ms", "sek", "min", "h", "d"};
+static const char *const TIME_UNIT_LABEL[] = {"ms", "sek", "min", "h", "d"}; // no String: avoids static constructors and heap allocations
 
+// log channels: errors and warnings are not evicted by chatty levels
+#define UNIVERSALUI_LOG_CHANNEL_MAIN 0
+#define UNIVERSALUI_LOG_CHANNEL_ALERT 1
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+#if UNIVERSALUI_ALERT_LOG_LENGTH >= LOGBUF_LENGTH
+#error "UNIVERSALUI_ALERT_LOG_LENGTH must be less than LOGBUF_LENGTH, it is taken from it"
+#endif
+#ifdef UNIVERSALUI_LOG_SPILL
+#error "UNIVERSALUI_LOG_SPILL does not support log channels (UNIVERSALUI_ALERT_LOG_LENGTH)"
+#endif
+#ifndef UNIVERSALUI_BINARY_LOG
+#define UNIVERSALUI_BINARY_LOG // merged view of the channels is ordered by the timestamp of the records
+#endif
+#define UNIVERSALUI_MAIN_LOG_LENGTH (LOGBUF_LENGTH - UNIVERSALUI_ALERT_LOG_LENGTH)
+#define UNIVERSALUI_LOG_CHANNELS 2
+typedef LogMergeSeq UniversalUI_LogSeq;             // cursor of getLogSeq() and beginLogRead(): one sequence number per channel
+typedef LogMergeReadState UniversalUI_LogReadState; // state of beginLogRead() and readLog(): all channels merged
+#else
+#define UNIVERSALUI_MAIN_LOG_LENGTH LOGBUF_LENGTH
+typedef size_t UniversalUI_LogSeq;
+typedef LogReadState UniversalUI_LogReadState;
+#endif
+
+#ifdef UNIVERSALUI_PERSISTENT_LOG
+#if defined(ESP32)
+#define UNIVERSALUI_NOINIT __NOINIT_ATTR
+#elif defined(ESP8266)
+#error "UNIVERSALUI_PERSISTENT_LOG is not supported on ESP8266: besides 512 bytes of RTC memory it has no memory surviving a reset"
+#else
+#define UNIVERSALUI_NOINIT __attribute__((section(".noinit")))
+#endif
+UNIVERSALUI_NOINIT char staticlogBufferMemory[LOGBUF_LENGTH];
+UNIVERSALUI_NOINIT LogBufferPersistence logBufferPersistence;
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+UNIVERSALUI_NOINIT LogBufferPersistence alertLogBufferPersistence;
+#endif
+#else
 char staticlogBufferMemory[LOGBUF_LENGTH];
+#endif
+
+// states of WiFi reconnect, advanced by UniversalUI::handle()
+enum UniversalUI_WifiState : byte
+{
+    WIFI_STATE_IDLE = 0,   // connected, or waiting for next reconnect attempt
+    WIFI_STATE_DISCONNECT, // reset WiFi
+    WIFI_STATE_BEGIN,      // start connecting
+    WIFI_STATE_POLL        // waiting for connection
+};
 
 /**
  * 
@@ -100,28 +235,103 @@ class UniversalUI
 private:
     // member constants
 
+#if !defined(UNIVERSALUI_NO_WIFI) && !defined(UNIVERSALUI_NO_STATUS_LED)
     blinkDuration_t OTA_ERROR_BLINK[4] = {125, 125, 875, 125};
+#endif
+#ifndef UNIVERSALUI_NO_WIFI
     const char *ssid = LOCAL_WIFI_SSID;
     const char *wpsk = LOCAL_WIFI_WPSK;
+#endif
     // variables
 
     const char *_appname;
-    BlinkLed *_statusLed;
+#ifndef UNIVERSALUI_NO_STATUS_LED
+    BlinkLed *_statusLed = nullptr;
+#endif
     String _statusMessage = "";
-    LogBuffer _log = LogBuffer(LOGBUF_LENGTH, staticlogBufferMemory, true);
-    bool _otaActive = false;
+#ifdef UNIVERSALUI_SERVICE_TASK
+    StaticSemaphore_t _statusMessageMutexBuffer;
+    SemaphoreHandle_t _statusMessageMutex = xSemaphoreCreateMutexStatic(&_statusMessageMutexBuffer);
+#endif
+#ifdef UNIVERSALUI_PERSISTENT_LOG
+    LogBuffer _log = LogBuffer(UNIVERSALUI_MAIN_LOG_LENGTH, staticlogBufferMemory, logBufferPersistence, true);
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+    LogBuffer _alertLog = LogBuffer(UNIVERSALUI_ALERT_LOG_LENGTH, &staticlogBufferMemory[UNIVERSALUI_MAIN_LOG_LENGTH], alertLogBufferPersistence, true);
+#endif
+#else
+    LogBuffer _log = LogBuffer(UNIVERSALUI_MAIN_LOG_LENGTH, staticlogBufferMemory, true);
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+    LogBuffer _alertLog = LogBuffer(UNIVERSALUI_ALERT_LOG_LENGTH, &staticlogBufferMemory[UNIVERSALUI_MAIN_LOG_LENGTH], true);
+#endif
+#endif
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+    LogBuffer *const _logChannels[UNIVERSALUI_LOG_CHANNELS] = {&_log, &_alertLog}; // indexed by UNIVERSALUI_LOG_CHANNEL_*
+#endif
+    NullLog _nullLog;
+#ifdef UNIVERSALUI_LOG_COALESCE
+#define UNIVERSALUI_LOG_COALESCING true
+#else
+#define UNIVERSALUI_LOG_COALESCING false // only staged
+#endif
+#if defined(UNIVERSALUI_LOG_STAGED) && defined(UNIVERSALUI_BINARY_LOG)
+    LogCoalescer _coalescer = LogCoalescer(nullptr, UNIVERSALUI_LOG_COALESCING);
+#elif defined(UNIVERSALUI_LOG_STAGED)
+    LogCoalescer _coalescer = LogCoalescer(formatLogRecord, UNIVERSALUI_LOG_COALESCING);
+#endif
+    byte _logLevel = UNIVERSALUI_LOG_LEVEL;
+    volatile bool _otaActive = false;
+#ifndef UNIVERSALUI_NO_NTP
     NTPClient *_timeClient = NULL;
+    AsyncNtpClient *_asyncTimeClient = nullptr;
     bool _ntpTimeValid = false;
+    byte _ntpTriesLeft = 0; // remaining initial tries of async NTP client, to be retried without waiting for NTP_RETRY_INTERVAL
+    unsigned long _ntpSyncEpoch = 0;  // time at last NTP sync, in [s] since 1970 including time offset
+    unsigned long _ntpSyncMillis = 0; // millis() at last NTP sync
+    unsigned long _timestampMillis = 0; // millis() at start of the second of _timestamp
+    bool _timestampValid = false;
+    char _timestamp[UNIVERSALUI_TIMESTAMP_SIZE] = ""; // current time as "HH:MM:SS", only updated if second changes; this and the sync time are changed under MUTEX_LOCK
+    char _timestampResult[UNIVERSALUI_TIMESTAMP_SIZE] = ""; // returned by getTimestamp()
     unsigned long _lastNtpUpdateMs = 0;
+#endif
+#ifndef UNIVERSALUI_NO_WIFI
     unsigned long _lastWifiReconnectCheck = 0;
+    unsigned long _wifiReconnectPeriod = UNIVERSALUI_WIFI_RECONNECT_PERIOD; // current backoff between reconnect attempts
+    UniversalUI_WifiState _wifiState = WIFI_STATE_IDLE;
+    byte _wifiTriesLeft = 0;
+    const char *volatile _wifiStatus = nullptr; // shown instead of _statusMessage while WiFi reconnects, so the message of the application is kept
+#endif
     const char *_userErrorMessage = nullptr;
     word _userErrorMessageBlinkTill = 0;
     /**
      * Number of current, independent activities.
      * As long there is activity, status LED shall be on.
      */
-    byte _activityCount = 0;
+    volatile byte _activityCount = 0;
+#ifdef UNIVERSALUI_HEAP_MONITOR
+    HeapMonitor _heapMonitor;
+#endif
+#ifdef UNIVERSALUI_LOG_SPILL
+    LogSpill _logSpill;
+#endif
+#ifdef UNIVERSALUI_SERVICE_TASK
+    TaskHandle_t _serviceTask = nullptr;
+#endif
+#ifdef COPY_TO_SERIAL_NONBLOCKING
+    LogReadState _serialState; // cursor of Serial in the log buffer
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+    LogReadState _alertSerialState;
+#endif
+#endif
 
+    /** Copies message, so it may be changed by another task meanwhile. */
+    void setStatusMessage(const char *message)
+    {
+        UNIVERSALUI_MESSAGE_LOCK
+        _statusMessage = message;
+        UNIVERSALUI_MESSAGE_UNLOCK
+    }
+
+#ifndef UNIVERSALUI_NO_WIFI
     void initOTA()
     {
 #if defined(ESP32) || defined(ESP8266)
@@ -190,108 +400,247 @@ private:
         ArduinoOTA.begin();
 #endif
     }
+#endif
 
-    void reconnectWifi()
+#if !defined(UNIVERSALUI_NO_WIFI) && (defined(ESP32) || defined(ESP8266))
+    /** @param message string literal, or nullptr to show the status message of the application again */
+    void setWifiStatus(const char *message)
     {
-#if defined(ESP32) || defined(ESP8266)
-        WiFi.persistent(false);
-        WiFi.disconnect();
-        WiFi.mode(WIFI_OFF);
-        WiFi.mode(WIFI_STA);
-        // WiFi.config(ip, gateway, subnet); // Only for fix IP needed
-        WiFi.begin(ssid, wpsk);
-        int triesLeft = UNIVERSALUI_WIFI_MAX_CONNECT_TRIES;
-        while (WiFi.status() != WL_CONNECTED && triesLeft > 0)
-        {
-            Serial.print(".");
-            --triesLeft;
-            delay(UNIVERSALUI_WIFI_RECONNECT_WAIT);
-        }
-        if (WiFi.status() == WL_CONNECTED)
+        _wifiStatus = message;
+    }
+
+    void printWifiFailure()
+    {
+        Serial << "\nConnect failed, status=" << WiFi.status() << " (";
+        switch (WiFi.status())
         {
-            Serial << "\nConnected with IP=" << WiFi.localIP() << endl;
-        }
-        else
+        case WL_IDLE_STATUS:
+            Serial << "IDLE";
+            break;
+        case WL_NO_SSID_AVAIL:
+            Serial << "NO_SSID_AVAIL";
+            break;
+        case WL_SCAN_COMPLETED:
+            Serial << "SCAN_COMPLETED";
+            break;
+        case WL_CONNECT_FAILED:
+            Serial << "CONNECT_FAILED";
+            break;
+        case WL_CONNECTION_LOST:
+            Serial << "CONNECTION_LOST";
+            break;
+        case WL_DISCONNECTED:
+            Serial << "DISCONNECTED";
+            break;
+        default:
+            Serial << "unknown";
+        };
+        Serial << ")" << endl;
+    }
+
+    /**
+     * Advances WiFi reconnect by one step, never blocks.
+     * If connection is lost, steps are: disconnect -> begin -> poll -> connected or wait (with exponential backoff) for next attempt.
+     * @return true if no reconnect is in progress
+     */
+    bool stepWifiReconnect()
+    {
+        switch (_wifiState)
         {
-            Serial << "\nConnect failed, status=" << WiFi.status() << " (";
-            switch (WiFi.status())
+        case WIFI_STATE_IDLE:
+            if (WiFi.status() == WL_CONNECTED)
             {
-            case WL_IDLE_STATUS:
-                Serial << "IDLE";
-                break;
-            case WL_NO_SSID_AVAIL:
-                Serial << "NO_SSID_AVAIL";
-                break;
-            case WL_SCAN_COMPLETED:
-                Serial << "SCAN_COMPLETED";
-                break;
-            case WL_CONNECT_FAILED:
-                Serial << "CONNECT_FAILED";
-                break;
-            case WL_CONNECTION_LOST:
-                Serial << "CONNECTION_LOST";
-                break;
-            case WL_DISCONNECTED:
-                Serial << "DISCONNECTED";
-                break;
-            default:
-                Serial << "unknown";
-            };
-            Serial << ")" << endl;
+                if (nullptr != _wifiStatus)
+                { // reconnected on its own while waiting for the next attempt
+                    _wifiReconnectPeriod = UNIVERSALUI_WIFI_RECONNECT_PERIOD;
+                    setWifiStatus(nullptr);
+                }
+                return true;
+            }
+            if ((millis() - _lastWifiReconnectCheck) <= _wifiReconnectPeriod)
+                return true;
+            logWarn() << "No connection, performing Wifi reset\n";
+            setWifiStatus("WiFi: reconnecting");
+            _wifiState = WIFI_STATE_DISCONNECT;
+            return false;
+        case WIFI_STATE_DISCONNECT:
+            WiFi.persistent(false);
+            WiFi.disconnect();
+            WiFi.mode(WIFI_OFF);
+            WiFi.mode(WIFI_STA);
+            _wifiState = WIFI_STATE_BEGIN;
+            return false;
+        case WIFI_STATE_BEGIN:
+            // WiFi.config(ip, gateway, subnet); // Only for fix IP needed
+            WiFi.begin(ssid, wpsk);
+            _wifiTriesLeft = UNIVERSALUI_WIFI_MAX_CONNECT_TRIES;
+            _lastWifiReconnectCheck = millis();
+            _wifiState = WIFI_STATE_POLL;
+            return false;
+        default: // WIFI_STATE_POLL
+            if (WiFi.status() == WL_CONNECTED)
+            {
+                Serial << "\nConnected with IP=" << WiFi.localIP() << endl;
+                _wifiReconnectPeriod = UNIVERSALUI_WIFI_RECONNECT_PERIOD;
+                setWifiStatus(nullptr);
+            }
+            else if ((millis() - _lastWifiReconnectCheck) < UNIVERSALUI_WIFI_RECONNECT_WAIT)
+            {
+                return false;
+            }
+            else if (--_wifiTriesLeft > 0)
+            {
+                Serial.print(".");
+                _lastWifiReconnectCheck = millis();
+                return false;
+            }
+            else
+            {
+                printWifiFailure();
 #ifdef UNIVERSALUI_WIFI_REBOOT_ON_FAILED_CONNECT
-            Serial << "restarting..." << endl;
-            delay(UNIVERSALUI_WIFI_RECONNECT_WAIT);
-            ESP.restart();
+                Serial << "restarting..." << endl;
+                delay(UNIVERSALUI_WIFI_RECONNECT_WAIT);
+                ESP.restart();
 #endif
+                _wifiReconnectPeriod = (_wifiReconnectPeriod < UNIVERSALUI_WIFI_RECONNECT_MAX_PERIOD / 2) ? 2 * _wifiReconnectPeriod : UNIVERSALUI_WIFI_RECONNECT_MAX_PERIOD;
+                logWarn() << "Wifi connect failed, next try in " << (_wifiReconnectPeriod / 1000) << "s\n";
+                setWifiStatus("WiFi: no connection");
+            }
+            _wifiState = WIFI_STATE_IDLE;
+            _lastWifiReconnectCheck = millis();
+            return true;
+        }
+    }
+
+    /** Blocking reconnect of WiFi, used at init(). */
+    void reconnectWifi()
+    {
+        _wifiState = WIFI_STATE_DISCONNECT;
+        while (!stepWifiReconnect())
+        {
+            delay(1);
         }
-        _lastWifiReconnectCheck = millis();
-#endif
     }
+#endif
 
+#ifndef UNIVERSALUI_NO_WIFI
     void statusErrorOta(const char *errorText)
     {
         Serial << "setting status to (ota) error: " << errorText << endl;
+#ifndef UNIVERSALUI_NO_STATUS_LED
+        UNIVERSALUI_STATUS_LOCK
         if (nullptr != _statusLed)
             _statusLed->setBlinkPattern4(OTA_ERROR_BLINK);
-        _statusMessage = errorText;
+        UNIVERSALUI_STATUS_UNLOCK
+#endif
+        setStatusMessage(errorText);
     }
+#endif
 
-    Print &log(const __FlashStringHelper *prefix)
+    Print &log(const uint8_t level)
     {
-        if (NULL != _timeClient && _ntpTimeValid)
+        if (level > _logLevel)
+            return _nullLog;
+#ifdef UNIVERSALUI_LOG_STAGED
+        const LogRecord record = {(uint32_t)millis(), isNtpTimeValid() ? (uint32_t)getEpochTime() : 0, level};
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        if (level <= UNIVERSALUI_LOGLEVEL_WARN)
+            return _coalescer.begin(_alertLog, record);
+#endif
+        return _coalescer.begin(_log, record);
+#elif defined(UNIVERSALUI_BINARY_LOG)
+        const LogRecord record = {(uint32_t)millis(), isNtpTimeValid() ? (uint32_t)getEpochTime() : 0, level};
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        if (level <= UNIVERSALUI_LOGLEVEL_WARN)
         {
-            _log << _timeClient->getFormattedTime();
+            _alertLog.writeRecord(record);
+            return _alertLog;
+        }
+#endif
+        _log.writeRecord(record);
+#else
+        if (isNtpTimeValid())
+        {
+            char timestamp[UNIVERSALUI_TIMESTAMP_SIZE];
+            _log << getTimestamp(timestamp);
         }
         else
         {
             _log << _WIDTH(millis(), 8);
         }
-        _log << F("   ") << prefix;
+        _log << F("   ") << levelPrefix(level);
+#endif
         return _log;
     }
 
+    static const __FlashStringHelper *levelPrefix(const uint8_t level)
+    {
+        switch (level)
+        {
+        case UNIVERSALUI_LOGLEVEL_ERROR:
+            return F("ERROR \t");
+        case UNIVERSALUI_LOGLEVEL_WARN:
+            return F("WARN \t");
+        case UNIVERSALUI_LOGLEVEL_INFO:
+            return F("INFO  \t");
+        case UNIVERSALUI_LOGLEVEL_DEBUG:
+            return F("DEBUG \t");
+        default:
+            return F("TRACE \t");
+        }
+    }
+
+    /**
+     * Formats a binary log record the same way as log() does in text mode.
+     * Called by LogBuffer with its lock held, which does not nest on ESP8266: so formats into a local buffer
+     * without using AppendBuffer, which locks as well.
+     */
+    static size_t formatLogRecord(const LogRecord &record, char *text, size_t maxTextLen)
+    {
+        if (0 == maxTextLen)
+            return 0;
+        char header[UINT32_DIGITS + 3 + 8]; // millis or "HH:MM:SS", separator, level prefix with terminator
+        char *pos = (0 != record.epoch) ? formatTime(header, record.epoch) : AppendBuffer::formatPadded(header, record.millis, 8, ' ');
+        memcpy(pos, "   ", 3);
+        pos += 3;
+        PGM_P prefix = (PGM_P)levelPrefix(record.level);
+        const size_t prefixLen = strlen_P(prefix);
+        memcpy_P(pos, prefix, prefixLen);
+        pos += prefixLen;
+        size_t len = pos - header;
+        if (len >= maxTextLen)
+            len = maxTextLen - 1;
+        memcpy(text, header, len);
+        text[len] = '\0';
+        return len;
+    }
+
     /** @return append position */
     static char *printTimeInterval(char *buf, word m, byte idx)
     {
-        const byte v = m % TIME_UNIT_DIVIDER[idx];
+        word v = m;
         if (0 < TIME_UNIT_DIVIDER[idx])
         {
+            v = m % TIME_UNIT_DIVIDER[idx];
             m /= TIME_UNIT_DIVIDER[idx];
             if (m > 0)
             {
                 buf = printTimeInterval(buf, m, idx + 1);
-                buf += sprintf(buf, ", ");
+                *buf++ = ',';
+                *buf++ = ' ';
             }
         }
-        buf += sprintf_P(buf, PSTR("%d%s"), v, &(TIME_UNIT_LABEL[idx][0]));
-        return buf;
+        buf = AppendBuffer::formatUInt(buf, v);
+        strcpy(buf, TIME_UNIT_LABEL[idx]);
+        return buf + strlen(TIME_UNIT_LABEL[idx]);
     }
 
-    static void appendTimeInterval(AppendBuffer buf, word m, byte idx)
+    static void appendTimeInterval(AppendBuffer &buf, word m, byte idx)
     {
-        const byte v = m % TIME_UNIT_DIVIDER[idx];
+        word v = m;
         if (0 < TIME_UNIT_DIVIDER[idx])
         {
+            v = m % TIME_UNIT_DIVIDER[idx];
             m /= TIME_UNIT_DIVIDER[idx];
             if (m > 0)
             {
@@ -299,9 +648,211 @@ private:
                 buf.append_P(F(", "));
             }
         }
-        buf.printf_P(PSTR("%d%s"), v, &(TIME_UNIT_LABEL[idx][0]));
+        buf.appendUInt(v);
+        buf.write(TIME_UNIT_LABEL[idx]);
+    }
+
+    /**
+     * Writes time of day of epoch as "HH:MM:SS" into buf, with terminating '\0', without locking.
+     * @return position of the terminator
+     */
+    static char *formatTime(char *buf, const unsigned long epoch)
+    {
+        buf = AppendBuffer::formatPadded(buf, (epoch % 86400L) / 3600, 2);
+        *buf++ = ':';
+        buf = AppendBuffer::formatPadded(buf, (epoch % 3600) / 60, 2);
+        *buf++ = ':';
+        return AppendBuffer::formatPadded(buf, epoch % 60, 2);
+    }
+
+    /** Appends time of day of epoch as "HH:MM:SS" */
+    static void appendTime(AppendBuffer &buf, const unsigned long epoch)
+    {
+        char time[9];
+        formatTime(time, epoch);
+        buf.write((const uint8_t *)time, 8);
+    }
+
+#ifndef UNIVERSALUI_NO_NTP
+    /** Captures time of NTP sync, all timestamps are derived from it. */
+    void captureNtpTime()
+    {
+        const unsigned long epoch = (nullptr != _asyncTimeClient) ? _asyncTimeClient->getEpochTime() : _timeClient->getEpochTime();
+        MUTEX_LOCK
+        _ntpSyncEpoch = epoch;
+        _ntpSyncMillis = millis();
+        _timestampValid = false;
+        MUTEX_UNLOCK
+    }
+
+    /** Advances _timestamp by one second. */
+    void incrementTimestamp()
+    {
+        static const char DIGIT_LIMIT[] = {'2', '9', ':', '5', '9', ':', '5', '9'}; // highest digit per position ("2" and "9" for hours are handled specially)
+        for (int8_t i = 7; i >= 0; --i)
+        {
+            if (':' == _timestamp[i])
+                continue;
+            if (1 == i && '2' == _timestamp[0] && '3' == _timestamp[1])
+            { // midnight
+                _timestamp[0] = '0';
+                _timestamp[1] = '0';
+                return;
+            }
+            if (_timestamp[i] < DIGIT_LIMIT[i])
+            {
+                ++_timestamp[i];
+                return;
+            }
+            _timestamp[i] = '0';
+        }
     }
 
+    /** Collects reply of async NTP client or sends next request if due. */
+    void handleAsyncNtp()
+    {
+        switch (_asyncTimeClient->poll())
+        {
+        case NTP_SUCCESS:
+            _ntpTimeValid = true;
+            captureNtpTime();
+            _ntpTriesLeft = 0;
+            _lastNtpUpdateMs = millis();
+            char timestamp[UNIVERSALUI_TIMESTAMP_SIZE];
+            logInfo() << "time updated successfully from NTP, time is " << getTimestamp(timestamp) << endl;
+            break;
+        case NTP_FAILED:
+            _ntpTimeValid = false;
+            _lastNtpUpdateMs = millis();
+            if (_ntpTriesLeft > 0)
+                --_ntpTriesLeft;
+            logError() << "time update failed from NTP (" << _ntpTriesLeft << ")" << endl;
+            if (_ntpTriesLeft > 0)
+                _asyncTimeClient->sendRequest();
+            break;
+        case NTP_IDLE:
+            if ((long)(millis() - _lastNtpUpdateMs) >= (_ntpTimeValid ? NTP_UPDATE_INTERVAL : NTP_RETRY_INTERVAL))
+            {
+                _asyncTimeClient->sendRequest();
+                _lastNtpUpdateMs = millis();
+            }
+            break;
+        default: // NTP_PENDING
+            break;
+        }
+    }
+#endif
+
+    /** Housekeeping of handle(), see there. With UNIVERSALUI_SERVICE_TASK called by serviceTask(). */
+    bool handleHousekeeping()
+    {
+        PERF_BEGIN(handleStart)
+#ifndef UNIVERSALUI_NO_STATUS_LED
+        UNIVERSALUI_STATUS_LOCK
+        if (nullptr != _statusLed)
+            _statusLed->update();
+        UNIVERSALUI_STATUS_UNLOCK
+#endif
+        PERF_END(PERF_HANDLE_LED, handleStart)
+#ifdef UNIVERSALUI_HEAP_MONITOR
+        _heapMonitor.handle();
+#endif
+#if !defined(UNIVERSALUI_NO_WIFI) && (defined(ESP32) || defined(ESP8266))
+        PERF_BEGIN(wifiStart)
+        stepWifiReconnect();
+        PERF_END(PERF_HANDLE_WIFI, wifiStart)
+
+        PERF_BEGIN(otaStart)
+        ArduinoOTA.handle();
+        PERF_END(PERF_HANDLE_OTA, otaStart)
+        if (_otaActive)
+        {
+            PERF_END(PERF_HANDLE, handleStart)
+            return false;
+        }
+#endif
+        // handle ui error blink off
+        if (_userErrorMessageBlinkTill > 0 && (millis() > _userErrorMessageBlinkTill))
+        {
+            if (0 == _activityCount)
+                statusLedOff();
+            else
+                statusLedOn();
+        }
+#ifndef UNIVERSALUI_NO_NTP
+        // update cycle for NTP queries
+        PERF_BEGIN(ntpStart)
+        if (nullptr != _asyncTimeClient)
+        {
+            handleAsyncNtp();
+        }
+        else if (NULL != _timeClient && ((long)(millis() - _lastNtpUpdateMs) >= (_ntpTimeValid ? NTP_UPDATE_INTERVAL : NTP_RETRY_INTERVAL)))
+        {
+            _ntpTimeValid = _timeClient->forceUpdate();
+            if (_ntpTimeValid)
+            {
+                captureNtpTime();
+                logInfo("time updated successfully from NTP");
+            }
+            else
+                logError("time update failed from NTP");
+            _lastNtpUpdateMs = millis();
+        }
+        PERF_END(PERF_HANDLE_NTP, ntpStart)
+#endif
+#ifdef UNIVERSALUI_LOG_STAGED
+        _coalescer.handle();
+#endif
+#ifdef COPY_TO_SERIAL_NONBLOCKING
+        mirrorToSerial(_log, _serialState);
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        mirrorToSerial(_alertLog, _alertSerialState);
+#endif
+#endif
+#ifdef UNIVERSALUI_LOG_SPILL
+        if (0 == _activityCount)
+            _logSpill.handle(_log);
+#endif
+        PERF_END(PERF_HANDLE, handleStart)
+        return true;
+    }
+
+#ifdef UNIVERSALUI_SERVICE_TASK
+    static void serviceTask(void *param)
+    {
+        UniversalUI *ui = (UniversalUI *)param;
+        for (;;)
+        {
+            ui->handleHousekeeping();
+            vTaskDelay(pdMS_TO_TICKS(UNIVERSALUI_SERVICE_TASK_INTERVAL));
+        }
+    }
+#endif
+
+#ifdef COPY_TO_SERIAL_NONBLOCKING
+    /** Starts mirroring with the content already in the log, unless it has been restored after a reset. */
+    static void beginSerialMirror(LogBuffer &log, LogReadState &state)
+    {
+        state.rawPercent = true;
+        log.beginRead(state, log.isRestored() ? log.getSeq() : 0);
+    }
+
+    /** Prints log content to Serial as far as its transmit buffer has space, so it never blocks. */
+    static void mirrorToSerial(LogBuffer &log, LogReadState &state)
+    {
+        uint8_t chunk[UNIVERSALUI_SERIAL_CHUNK];
+        int space = Serial.availableForWrite();
+        while (space > 0)
+        {
+            const size_t len = log.readFollow(chunk, (space < UNIVERSALUI_SERIAL_CHUNK) ? space : UNIVERSALUI_SERIAL_CHUNK, state);
+            if (0 == len)
+                break;
+            Serial.write(chunk, len);
+            space -= len;
+        }
+    }
+#endif
+
     void checkStatusLed()
     {
         if (0 == _userErrorMessageBlinkTill)
@@ -321,6 +872,12 @@ public:
     UniversalUI(const char *appname)
     {
         _appname = appname;
+#ifdef UNIVERSALUI_BINARY_LOG
+        _log.setRecordFormatter(formatLogRecord);
+#endif
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        _alertLog.setRecordFormatter(formatLogRecord);
+#endif
     }
 
     const char *getAppName() const
@@ -328,19 +885,101 @@ public:
         return _appname;
     }
 
+#ifndef UNIVERSALUI_NO_NTP
     void setNtpClient(NTPClient *timeClient)
     {
         _timeClient = timeClient;
     }
 
+    /**
+     * Uses the given NTP client without blocking: neither init() nor handle() wait for the reply of the NTP server.
+     */
+    void setNtpClient(AsyncNtpClient *timeClient)
+    {
+        _asyncTimeClient = timeClient;
+    }
+
     bool isNtpTimeValid()
     {
-        return _timeClient != NULL && _ntpTimeValid;
+        return (_timeClient != NULL || _asyncTimeClient != nullptr) && _ntpTimeValid;
+    }
+
+    /** @return seconds since 1970 including time offset, only valid if isNtpTimeValid() */
+    unsigned long getEpochTime()
+    {
+        MUTEX_LOCK
+        const unsigned long syncEpoch = _ntpSyncEpoch;
+        const unsigned long syncMillis = _ntpSyncMillis;
+        MUTEX_UNLOCK
+        return syncEpoch + (millis() - syncMillis) / 1000;
+    }
+
+    /**
+     * Copies the current time as "HH:MM:SS" into buf, empty if no NTP time available.
+     * Is cached, and only updated (incrementally) when the second changes. Can be called from any task.
+     * @param buf of at least UNIVERSALUI_TIMESTAMP_SIZE characters
+     * @return buf
+     */
+    char *getTimestamp(char *buf)
+    {
+        buf[0] = '\0';
+        if (!isNtpTimeValid())
+            return buf;
+        MUTEX_LOCK
+        const unsigned long elapsed = millis() - _timestampMillis;
+        const bool cached = _timestampValid && (elapsed < 2000);
+        if (cached && (elapsed >= 1000))
+        {
+            _timestampMillis += 1000;
+            incrementTimestamp();
+        }
+        if (cached)
+            memcpy(buf, _timestamp, UNIVERSALUI_TIMESTAMP_SIZE);
+        const unsigned long syncEpoch = _ntpSyncEpoch;
+        const unsigned long syncMillis = _ntpSyncMillis;
+        MUTEX_UNLOCK
+        if (cached)
+            return buf;
+        const unsigned long now = millis();
+        const unsigned long sinceSync = now - syncMillis;
+        AppendBuffer timestamp(UNIVERSALUI_TIMESTAMP_SIZE, buf); // formatted outside of the critical section, since AppendBuffer locks itself
+        appendTime(timestamp, syncEpoch + sinceSync / 1000);
+        MUTEX_LOCK
+        if (syncMillis == _ntpSyncMillis)
+        { // not synced again meanwhile
+            memcpy(_timestamp, buf, UNIVERSALUI_TIMESTAMP_SIZE);
+            _timestampMillis = now - (sinceSync % 1000);
+            _timestampValid = true;
+        }
+        MUTEX_UNLOCK
+        return buf;
+    }
+    /**
+     * Current time as "HH:MM:SS", empty if no NTP time available.
+     * Note: the result is overwritten by the next call, so use getTimestamp(char *) if called from several tasks.
+     */
+    const char *getTimestamp()
+    {
+        return getTimestamp(_timestampResult);
+    }
+#else
+    bool isNtpTimeValid() { return false; }
+    /** @return always 0, since compiled with UNIVERSALUI_NO_NTP */
+    unsigned long getEpochTime() { return 0; }
+    /** @return always empty, since compiled with UNIVERSALUI_NO_NTP */
+    char *getTimestamp(char *buf)
+    {
+        buf[0] = '\0';
+        return buf;
     }
+    /** @return always empty, since compiled with UNIVERSALUI_NO_NTP */
+    const char *getTimestamp() { return ""; }
+#endif
 
     String getFormattedTime()
     {
-        return (isNtpTimeValid()) ? _timeClient->getFormattedTime() : "";
+        char timestamp[UNIVERSALUI_TIMESTAMP_SIZE];
+        return getTimestamp(timestamp);
     }
 
     /** 
@@ -371,13 +1010,26 @@ public:
      * @param mainFileName to be provided with macro <code>__FILE__</code>
      * @param buildTimestamp to be provided with macro <code>__TIMESTAMP__</code>
      */
+#ifdef UNIVERSALUI_NO_STATUS_LED
+    void init(const int /*statusLedPin*/, const bool /*statusLedActiveOnLow*/, const __FlashStringHelper *mainFileName, const __FlashStringHelper *buildTimestamp)
+#else
     void init(const int statusLedPin, const bool statusLedActiveOnLow, const __FlashStringHelper *mainFileName, const __FlashStringHelper *buildTimestamp)
+#endif
     {
         Serial.begin(UNIVERSALUI_SERIAL_BAUDRATE);
         while (!Serial)
             ;
+#ifdef COPY_TO_SERIAL_NONBLOCKING
+        beginSerialMirror(_log, _serialState);
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        beginSerialMirror(_alertLog, _alertSerialState);
+#endif
+#endif
+        if (_log.isRestored())
+            logInfo() << F("--- log continued after reset ---") << endl;
         logInfo() << "Sketchname: " << mainFileName << ", Build: " << buildTimestamp << ", SDK: " << _UNIVERSALUI_SDKVERSION << endl;
         //Serial <<"compiler version: "<< __VERSION__<<endl;
+#ifndef UNIVERSALUI_NO_STATUS_LED
         if (NOT_A_PIN != statusLedPin)
         {
             Serial << "setting status pin to " << statusLedPin << endl;
@@ -388,8 +1040,9 @@ public:
         {
             _statusLed = nullptr;
         }
+#endif
 
-#if defined(ESP32) || defined(ESP8266)
+#if !defined(UNIVERSALUI_NO_WIFI) && (defined(ESP32) || defined(ESP8266))
         Serial << endl
                << "MAC address is " << WiFi.macAddress() << endl;
 
@@ -398,12 +1051,18 @@ public:
 #elif defined(ESP8266)
         WiFi.hostname(_appname);
 #endif
-#if defined(ESP32) || defined(ESP8266)
         reconnectWifi();
-#endif
 
         initOTA();
-        if (NULL != _timeClient)
+#ifndef UNIVERSALUI_NO_NTP
+        if (nullptr != _asyncTimeClient)
+        {
+            _asyncTimeClient->begin();
+            _ntpTriesLeft = NTP_INITIAL_TRIES;
+            _asyncTimeClient->sendRequest();
+            _lastNtpUpdateMs = millis();
+        }
+        else if (NULL != _timeClient)
         {
             _timeClient->begin();
             int ntpTries = NTP_INITIAL_TRIES;
@@ -412,8 +1071,10 @@ public:
                 _ntpTimeValid = _timeClient->forceUpdate();
                 if (_ntpTimeValid)
                 {
+                    captureNtpTime();
                     _lastNtpUpdateMs = millis();
-                    logInfo() << "initialized NTP client at millis()=" << _lastNtpUpdateMs << ", time is " << _timeClient->getFormattedTime() << endl;
+                    char timestamp[UNIVERSALUI_TIMESTAMP_SIZE];
+                    logInfo() << "initialized NTP client at millis()=" << _lastNtpUpdateMs << ", time is " << getTimestamp(timestamp) << endl;
                     ntpTries = 0;
                     break;
                 }
@@ -422,6 +1083,13 @@ public:
                 delay(500);
             } while (ntpTries > 0);
         }
+#endif
+#endif
+#ifdef UNIVERSALUI_SERVICE_TASK
+#ifdef UNIVERSALUI_HEAP_MONITOR
+        _heapMonitor.setTask(xTaskGetCurrentTaskHandle()); // stack watermark of arduino loop
+#endif
+        xTaskCreatePinnedToCore(serviceTask, "universalUI", UNIVERSALUI_SERVICE_TASK_STACK, this, UNIVERSALUI_SERVICE_TASK_PRIORITY, &_serviceTask, UNIVERSALUI_SERVICE_TASK_CORE);
 #endif
         Serial << "\nReady\n\n";
     }
@@ -429,13 +1097,21 @@ public:
     /**
      * Sets current blink interval. LED off is 0, 0.
      */
+#ifdef UNIVERSALUI_NO_STATUS_LED
+    void setBlink(const int /*onMillis*/, const int /*offMillis*/)
+    {
+    }
+#else
     void setBlink(const int onMillis, const int offMillis)
     {
+        UNIVERSALUI_STATUS_LOCK
         if (nullptr != _statusLed)
         {
             _statusLed->setBlink(onMillis, offMillis);
         }
+        UNIVERSALUI_STATUS_UNLOCK
     }
+#endif
 
     /**
      * Stops current status led effect and switches it off.
@@ -443,8 +1119,12 @@ public:
      */
     void statusLedOff()
     {
+#ifndef UNIVERSALUI_NO_STATUS_LED
+        UNIVERSALUI_STATUS_LOCK
         if (nullptr != _statusLed)
             _statusLed->off();
+        UNIVERSALUI_STATUS_UNLOCK
+#endif
     }
 
     /**
@@ -453,15 +1133,21 @@ public:
      */
     void statusLedOn()
     {
+#ifndef UNIVERSALUI_NO_STATUS_LED
+        UNIVERSALUI_STATUS_LOCK
         if (nullptr != _statusLed)
             _statusLed->on();
+        UNIVERSALUI_STATUS_UNLOCK
+#endif
     }
 
     /** Notifies about starting an activity. */
     void startActivity()
     {
-        ++_activityCount;
-        if (1 == _activityCount)
+        UNIVERSALUI_STATUS_LOCK
+        const byte count = ++_activityCount;
+        UNIVERSALUI_STATUS_UNLOCK
+        if (1 == count)
         {
             statusLedOn();
         }
@@ -470,7 +1156,9 @@ public:
     /** Notfies about a finished activity. */
     void finishActivity()
     {
+        UNIVERSALUI_STATUS_LOCK
         --_activityCount;
+        UNIVERSALUI_STATUS_UNLOCK
         checkStatusLed();
     }
 
@@ -478,21 +1166,21 @@ public:
     {
         Serial << "setting status to active: " << message << endl;
         statusLedOn();
-        _statusMessage = message;
+        setStatusMessage(message);
     }
 
     void statusError(const char *message)
     {
         Serial << "setting status to error: " << message << endl;
         setBlink(125, 125);
-        _statusMessage = message;
+        setStatusMessage(message);
     }
 
     void statusOk()
     {
         Serial << "setting status to ok" << endl;
         statusLedOff();
-        _statusMessage = "";
+        setStatusMessage("");
     }
 
     /** Indicates error in user interaction (no system error).
@@ -509,8 +1197,7 @@ public:
             logDebug() << F("ui error blink with overflow: millis=") << millis() << F(", should blink till") << _userErrorMessageBlinkTill << endl;
             _userErrorMessageBlinkTill = -1000;
         }
-        if (nullptr != _statusLed)
-            setBlink(200, 300);
+        setBlink(200, 300);
     }
 
     /** Indicate that the error in user interaction has been resolved. */
@@ -531,80 +1218,173 @@ public:
         return _userErrorMessage;
     }
 
-    bool hasStatusMessage() { return '\0' != _statusMessage[0]; }
-    const char *getStatusMessage() { return _statusMessage.c_str(); }
+    bool hasStatusMessage()
+    {
+#ifndef UNIVERSALUI_NO_WIFI
+        if (nullptr != _wifiStatus)
+            return true;
+#endif
+        UNIVERSALUI_MESSAGE_LOCK
+        const bool has = (_statusMessage.length() > 0);
+        UNIVERSALUI_MESSAGE_UNLOCK
+        return has;
+    }
+    /**
+     * Prints the WiFi status while reconnecting, else the message set by statusActive(), statusError() or statusOk().
+     * Can be called from any task, e.g. by a placeholder printer.
+     * @return number of bytes printed
+     */
+    size_t printStatusMessage(Print &out)
+    {
+#ifndef UNIVERSALUI_NO_WIFI
+        const char *wifiStatus = _wifiStatus;
+        if (nullptr != wifiStatus)
+            return out.print(wifiStatus);
+#endif
+        UNIVERSALUI_MESSAGE_LOCK
+        const size_t len = out.print(_statusMessage);
+        UNIVERSALUI_MESSAGE_UNLOCK
+        return len;
+    }
+    /**
+     * @return the status message, see printStatusMessage().
+     * Valid only till the next status change, so use it on the loop task only, other tasks use copyStatusMessage() or printStatusMessage().
+     */
+    const char *getStatusMessage()
+    {
+#ifndef UNIVERSALUI_NO_WIFI
+        const char *wifiStatus = _wifiStatus;
+        if (nullptr != wifiStatus)
+            return wifiStatus;
+#endif
+        UNIVERSALUI_MESSAGE_LOCK
+        const char *message = _statusMessage.c_str();
+        UNIVERSALUI_MESSAGE_UNLOCK
+        return message;
+    }
+    /** @return copy of the status message, see printStatusMessage(). Can be called from any task. */
+    String copyStatusMessage()
+    {
+#ifndef UNIVERSALUI_NO_WIFI
+        const char *wifiStatus = _wifiStatus;
+        if (nullptr != wifiStatus)
+            return wifiStatus;
+#endif
+        UNIVERSALUI_MESSAGE_LOCK
+        const String message = _statusMessage;
+        UNIVERSALUI_MESSAGE_UNLOCK
+        return message;
+    }
+#ifdef UNIVERSALUI_HEAP_MONITOR
+    const HeapMonitor &getHeapMonitor() const { return _heapMonitor; }
+#endif
+#ifdef UNIVERSALUI_LOG_SPILL
+    /**
+     * Starts copying the log into rotating files, written by handle() while there is no activity.
+     * @param fs must already be mounted, e.g. <code>SPIFFS.begin()</code> in <code>serverSetup()</code>
+     */
+    void enableLogSpill(fs::FS &fs)
+    {
+        _logSpill.begin(fs, _log);
+    }
+    /** Writes all log content not yet in a file, e.g. before a planned restart. Not to be used with UNIVERSALUI_SERVICE_TASK. */
+    void flushLogSpill()
+    {
+        _logSpill.flush(_log);
+    }
+#endif
 
     /**
      * To be called in <code>loop()</code>.
      * <ul>
      * <li>updates state of blink pin</li>
-     * <li>checks OTA</li>
+     * <li>advances WiFi reconnect, without blocking, and checks OTA - unless UNIVERSALUI_NO_WIFI is defined</li>
+     * <li>updates NTP time, unless UNIVERSALUI_NO_NTP is defined</li>
+     * <li>samples heap, if UNIVERSALUI_HEAP_MONITOR is defined</li>
+     * <li>writes pending "last message repeated" notes, if UNIVERSALUI_LOG_COALESCE is defined</li>
+     * <li>prints new log content to Serial without blocking, if COPY_TO_SERIAL_NONBLOCKING is defined</li>
+     * <li>writes a batch of the log into a file while there is no activity, if UNIVERSALUI_LOG_SPILL is defined</li>
      * </ul>
      * 
+     * With UNIVERSALUI_SERVICE_TASK this is done by the service task started in init(), then handle() only checks for OTA.
+     * 
      * @return true if no internal activity and more workload can be processed
      */
     bool handle()
     {
-        if (nullptr != _statusLed)
-            _statusLed->update();
-#if defined(ESP32) || defined(ESP8266)
-        if ((WiFi.status() != WL_CONNECTED) && (millis() - _lastWifiReconnectCheck) > UNIVERSALUI_WIFI_RECONNECT_PERIOD)
-        {
-            logWarn() << "No connection, performing Wifi reset\n";
-            reconnectWifi();
-        }
-
-        ArduinoOTA.handle();
-        if (_otaActive)
-        {
-            return false;
-        }
+#ifdef UNIVERSALUI_SERVICE_TASK
+        return !_otaActive;
+#else
+        return handleHousekeeping();
 #endif
-        // handle ui error blink off
-        if (_userErrorMessageBlinkTill > 0 && (millis() > _userErrorMessageBlinkTill))
-        {
-            if (0 == _activityCount)
-                statusLedOff();
-            else
-                statusLedOn();
-        }
-        // update cycle for NTP queries
-        if (NULL != _timeClient && ((long)(millis() - _lastNtpUpdateMs) >= (_ntpTimeValid ? NTP_UPDATE_INTERVAL : NTP_RETRY_INTERVAL)))
-        {
-            _ntpTimeValid = _timeClient->forceUpdate();
-            if (_ntpTimeValid)
-                logInfo("time updated successfully from NTP");
-            else
-                logError("time update failed from NTP");
-            _lastNtpUpdateMs = millis();
-        }
-        return true;
+    }
+
+    /**
+     * Sets the log level at runtime: log entries with higher level are dropped.
+     * Levels above UNIVERSALUI_LOG_LEVEL are removed at compile time anyway.
+     * @param level one of UNIVERSALUI_LOGLEVEL_ERROR .. UNIVERSALUI_LOGLEVEL_TRACE
+     */
+    void setLogLevel(const byte level)
+    {
+        _logLevel = level;
+    }
+    byte getLogLevel() const
+    {
+        return _logLevel;
     }
 
     Print &logError()
     {
-        return log(F("ERROR \t"));
+        return log(UNIVERSALUI_LOGLEVEL_ERROR);
     }
 
+#if UNIVERSALUI_LOG_LEVEL >= UNIVERSALUI_LOGLEVEL_WARN
     Print &logWarn()
     {
-        return log(F("WARN \t"));
+        return log(UNIVERSALUI_LOGLEVEL_WARN);
+    }
+#else
+    NullLog &logWarn()
+    {
+        return _nullLog;
     }
+#endif
 
+#if UNIVERSALUI_LOG_LEVEL >= UNIVERSALUI_LOGLEVEL_INFO
     Print &logInfo()
     {
-        return log(F("INFO  \t"));
+        return log(UNIVERSALUI_LOGLEVEL_INFO);
+    }
+#else
+    NullLog &logInfo()
+    {
+        return _nullLog;
     }
+#endif
 
+#if UNIVERSALUI_LOG_LEVEL >= UNIVERSALUI_LOGLEVEL_DEBUG
     Print &logDebug()
     {
-        return log(F("DEBUG \t"));
+        return log(UNIVERSALUI_LOGLEVEL_DEBUG);
+    }
+#else
+    NullLog &logDebug()
+    {
+        return _nullLog;
     }
+#endif
 
+#if UNIVERSALUI_LOG_LEVEL >= UNIVERSALUI_LOGLEVEL_TRACE
     Print &logTrace()
     {
-        return log(F("TRACE \t"));
+        return log(UNIVERSALUI_LOGLEVEL_TRACE);
+    }
+#else
+    NullLog &logTrace()
+    {
+        return _nullLog;
     }
+#endif
 
     void logError(const String msg)
     {
@@ -640,25 +1420,105 @@ public:
     }
 
     /** 
-     * Note: LogBuffer implements fix for https://github.com/me-no-dev/ESPAsyncWebServer/issues/333: '%' in template result is evaluated as template again
+     * Copies the log buffer content into buf, preceded by "[...] " if clipped, see <code>LogBuffer::getLog(char *, size_t)</code>.
+     * Delivers '%' encoded as "%%", see https://github.com/me-no-dev/ESPAsyncWebServer/issues/333 ('%' in template result is evaluated as template again)
+     * With UNIVERSALUI_ALERT_LOG_LENGTH the channels are merged, like the chunked getHtmlLog() with LogMergeReadState.
+     * @return length of the complete content, if it is size or more, buf holds only the oldest part
      */
-    const char *getHtmlLog(const byte part)
+    size_t getHtmlLog(char *buf, const size_t size)
     {
-        return _log.getLog(part);
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        LogMergeReadState state;
+        beginMergedRead(_logChannels, UNIVERSALUI_LOG_CHANNELS, state);
+        size_t len = 0;
+        size_t filled;
+        while (((len + 1) < size) && (0 != (filled = readMergedLog(_logChannels, UNIVERSALUI_LOG_CHANNELS, (uint8_t *)&buf[len], size - len - 1, state))))
+            len += filled;
+        if (0 != size)
+            buf[len] = '\0';
+        uint8_t rest[32];
+        while (0 != (filled = readMergedLog(_logChannels, UNIVERSALUI_LOG_CHANNELS, rest, sizeof(rest), state))) // content not fitting, only counted
+            len += filled;
+        return len;
+#else
+        return _log.getLog(buf, size);
+#endif
     }
     /**
-     * 
+     * Chunked read of log buffer, see <code>LogBuffer::getLog(uint8_t *, size_t, size_t, LogReadState &)</code>.
+     * Delivers '%' encoded as "%%", see https://github.com/me-no-dev/ESPAsyncWebServer/issues/333
+     */
+    size_t getHtmlLog(uint8_t *buf, size_t maxLen, size_t index, LogReadState &readState)
+    {
+        return _log.getLog(buf, maxLen, index, readState);
+    }
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+    /** Same as getHtmlLog(), but delivers errors and warnings merged by time with the other entries, see <code>readMergedLog()</code>. */
+    size_t getHtmlLog(uint8_t *buf, size_t maxLen, size_t index, LogMergeReadState &readState)
+    {
+        return readMergedLog(_logChannels, UNIVERSALUI_LOG_CHANNELS, buf, maxLen, index, readState);
+    }
+    /**
+     * Same as getHtmlLog(), but delivers only the given channel: UNIVERSALUI_LOG_CHANNEL_MAIN or UNIVERSALUI_LOG_CHANNEL_ALERT (errors and warnings).
+     * @return 0 for an unknown channel
+     */
+    size_t getHtmlLog(const uint8_t channel, uint8_t *buf, size_t maxLen, size_t index, LogReadState &readState)
+    {
+        if (channel >= UNIVERSALUI_LOG_CHANNELS)
+            return 0;
+        return _logChannels[channel]->getLog(buf, maxLen, index, readState);
+    }
+#endif
+#ifdef UNIVERSALUI_LOG_SPILL
+    /** Same as getHtmlLog(), but delivers the log files written before, followed by the log buffer, see <code>LogSpill::getLog()</code>. */
+    size_t getHtmlLog(uint8_t *buf, size_t maxLen, size_t index, LogSpillReadState &readState)
+    {
+        return _logSpill.getLog(_log, buf, maxLen, index, readState);
+    }
+#endif
+    /**
+     * Same as getHtmlLog(), but delivers only the content logged after since, see <code>LogBuffer::beginRead()</code>.
+     * With UNIVERSALUI_ALERT_LOG_LENGTH since holds a sequence number per channel, and the channels are merged (see <code>beginMergedRead()</code>).
      */
-    const size_t getHtmlLog(uint8_t *buf, size_t maxLen, size_t index, size_t &bufferRotationPoint)
+    size_t getHtmlLogSince(const UniversalUI_LogSeq &since, uint8_t *buf, size_t maxLen, size_t index, UniversalUI_LogReadState &readState)
     {
-        return _log.getLog(buf, maxLen, index, bufferRotationPoint);
+        if (0 == index)
+            beginLogRead(readState, since);
+        return readLog(buf, maxLen, readState);
+    }
+    /** @return sequence number of the next character to be logged, see <code>LogBuffer::getSeq()</code>, one per channel with UNIVERSALUI_ALERT_LOG_LENGTH */
+    UniversalUI_LogSeq getLogSeq() const
+    {
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        return getMergedSeq(_logChannels, UNIVERSALUI_LOG_CHANNELS);
+#else
+        return _log.getSeq();
+#endif
+    }
+    /** Starts a chunked read of the log, see <code>LogBuffer::beginRead()</code>. @return sequence number at the end of this read */
+    UniversalUI_LogSeq beginLogRead(UniversalUI_LogReadState &readState, const UniversalUI_LogSeq &since = UniversalUI_LogSeq())
+    {
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        return beginMergedRead(_logChannels, UNIVERSALUI_LOG_CHANNELS, readState, since);
+#else
+        return _log.beginRead(readState, since);
+#endif
+    }
+    /** Continues a read started with beginLogRead(), see <code>LogBuffer::readLog()</code> (or <code>readMergedLog()</code> with UNIVERSALUI_ALERT_LOG_LENGTH). */
+    size_t readLog(uint8_t *buf, size_t maxLen, UniversalUI_LogReadState &readState)
+    {
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        return readMergedLog(_logChannels, UNIVERSALUI_LOG_CHANNELS, buf, maxLen, readState);
+#else
+        return _log.readLog(buf, maxLen, readState);
+#endif
     }
 
     static void printTimeInterval(char *buf, word millis)
     {
         printTimeInterval(buf, millis, 0);
     }
-    static void appendTimeInterval(AppendBuffer buf, word millis)
+    static void appendTimeInterval(AppendBuffer &buf, word millis)
     {
         appendTimeInterval(buf, millis, 0);
     }
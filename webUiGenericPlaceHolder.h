@@ -12,101 +12,267 @@ extern "C"
 #include "universalUIglobal.h"
 #include "debug.h"
 
-String universalUiPlaceholderProcessor(const String &var, AppendBuffer &buf)
+#ifndef UNIVERSALUI_MAX_PLACEHOLDERS
+#define UNIVERSALUI_MAX_PLACEHOLDERS 16 // maximum number of placeholders registered with registerPlaceholder()
+#endif
+#ifndef UNIVERSALUI_PLACEHOLDER_MAXLEN
+#define UNIVERSALUI_PLACEHOLDER_MAXLEN 32 // maximum length of placeholder names in templates, like AsyncWebServer's TEMPLATE_PARAM_NAME_LENGTH
+#endif
+#ifndef UNIVERSALUI_PLACEHOLDER_OVERFLOW
+#ifdef UNIVERSALUI_PROFILE
+#define UNIVERSALUI_PLACEHOLDER_OVERFLOW 512 // "%PERF%" needs about 60 bytes per probe
+#else
+#define UNIVERSALUI_PLACEHOLDER_OVERFLOW 256 // placeholder output not fitting into response buffer is kept for next chunk, up to this length
+#endif
+#endif
+#ifndef UNIVERSALUI_MAX_STREAMING_PLACEHOLDERS
+#define UNIVERSALUI_MAX_STREAMING_PLACEHOLDERS 4 // maximum number of placeholders registered with registerStreamingPlaceholder()
+#endif
+#ifndef UNIVERSALUI_MAX_CACHED_TEMPLATES
+#define UNIVERSALUI_MAX_CACHED_TEMPLATES 4 // maximum number of templates parsed with cacheTemplate()
+#endif
+#ifndef UNIVERSALUI_TEMPLATE_SEGMENTS
+#define UNIVERSALUI_TEMPLATE_SEGMENTS 64 // number of segments available for all cached templates
+#endif
+#ifndef UNIVERSALUI_TEMPLATE_CHUNK
+#define UNIVERSALUI_TEMPLATE_CHUNK 256 // size of template file reads
+#endif
+#if UNIVERSALUI_TEMPLATE_CHUNK < (UNIVERSALUI_PLACEHOLDER_MAXLEN + 2)
+#error "UNIVERSALUI_TEMPLATE_CHUNK must hold a placeholder name including its delimiters"
+#endif
+
+typedef String (*PlaceholderProcessor)(const String &var, AppendBuffer &buf);
+/**
+ * Prints value of placeholder directly to out, no String needed.
+ * @return number of bytes printed
+ */
+typedef size_t (*PlaceholderPrinter)(const char *var, Print &out);
+/**
+ * Delivers content of a streaming placeholder like "$LOG$" in chunks, like AwsResponseFiller.
+ * @param index number of bytes delivered for this placeholder so far
+ * @return number of bytes filled into buf, 0 if completely delivered, or RESPONSE_TRY_AGAIN
+ */
+typedef size_t (*StreamingPlaceholderFiller)(uint8_t *buf, size_t maxLen, size_t index);
+
+/** FNV-1a hash of placeholder names, evaluated at compile time for constant names (like in case labels). */
+constexpr uint32_t placeholderHash(const char *name, const uint32_t hash = 2166136261UL)
+{
+    return ('\0' == *name) ? hash : placeholderHash(name + 1, (hash ^ (uint8_t)*name) * 16777619UL);
+}
+/** Same as placeholderHash(), iterative for use at runtime. */
+uint32_t placeholderHashOf(const char *name)
+{
+    uint32_t hash = 2166136261UL;
+    while ('\0' != *name)
+        hash = (hash ^ (uint8_t)*name++) * 16777619UL;
+    return hash;
+}
+
+struct PlaceholderRegistration
+{
+    uint32_t hash;
+    const char *name; // compared after a hit of hash, since different names may have the same hash
+    PlaceholderProcessor processor; // either processor or printer is set
+    PlaceholderPrinter printer;
+};
+static PlaceholderRegistration registeredPlaceholders[UNIVERSALUI_MAX_PLACEHOLDERS]; // sorted by hash
+static uint8_t registeredPlaceholderCount = 0;
+
+bool registerPlaceholder(const char *name, PlaceholderProcessor processor, PlaceholderPrinter printer)
 {
-    if (0 == strcmp_P(var.c_str(), PSTR("APPNAME")))
-        return ui.getAppName();
-    if (0 == strcmp_P(var.c_str(), PSTR("__TIMESTAMP__")))
-        return F(__TIMESTAMP__);
-    if (0 == strcmp_P(var.c_str(), PSTR("STATUS")))
-        return ui.getStatusMessage();
-    if (0 == strcmp_P(var.c_str(), PSTR("STATUSBAR")))
+    const uint32_t hash = placeholderHashOf(name);
+    if (registeredPlaceholderCount >= UNIVERSALUI_MAX_PLACEHOLDERS)
     {
-        if (ui.hasStatusMessage())
+        ui.logError() << F("too many placeholders, not registered: ") << name << endl;
+        return false;
+    }
+    uint8_t pos = registeredPlaceholderCount;
+    while ((pos > 0) && (registeredPlaceholders[pos - 1].hash >= hash))
+    {
+        if (registeredPlaceholders[pos - 1].hash == hash)
         {
-            buf.reset();
-            //buf.printf_P(PSTR("<p style=\"color:blue;background-color:lightgrey;text-align:center;\">Status: %s</p>"), ui.getStatusMessage());
-            buf.append_P(F("<p style=\"color:blue;background-color:lightgrey;text-align:center;\">Status: "));
-            buf.append(ui.getStatusMessage());
-            buf.append_P(F("</p>"));
-            return buf.c_str();
+            ui.logError() << F("placeholder already registered: ") << name << endl;
+            return false;
         }
+        --pos;
+    }
+    memmove(&registeredPlaceholders[pos + 1], &registeredPlaceholders[pos], (registeredPlaceholderCount - pos) * sizeof(PlaceholderRegistration));
+    registeredPlaceholders[pos] = {hash, name, processor, printer};
+    ++registeredPlaceholderCount;
+    return true;
+}
+
+/**
+ * Registers a processor for the given placeholder name, to be used by universalUiPlaceholderProcessor() and universalUiPlaceholderPrinter().
+ * Lookup is done by hash of the name, so there is no need to chain processors anymore.
+ * A registered name takes precedence over the builtin placeholders.
+ * 
+ * @param name placeholder name (without '%'), is referenced and not copied, so it must stay valid (e.g. a string literal)
+ * @param processor is called with the placeholder name, so one processor can serve several names
+ * @return false if UNIVERSALUI_MAX_PLACEHOLDERS is reached or name (or its hash) is already registered
+ */
+bool registerPlaceholder(const char *name, PlaceholderProcessor processor)
+{
+    return registerPlaceholder(name, processor, nullptr);
+}
+/** Same as above, but registers a printer: if used with TemplateResponseDataSource, it prints directly into the response buffer. */
+bool registerPlaceholder(const char *name, PlaceholderPrinter printer)
+{
+    return registerPlaceholder(name, nullptr, printer);
+}
+
+/** @return registration for given name and its hash, or nullptr */
+const PlaceholderRegistration *findRegisteredPlaceholder(const char *name, const uint32_t hash)
+{
+    uint8_t low = 0;
+    uint8_t high = registeredPlaceholderCount;
+    while (low < high)
+    {
+        const uint8_t mid = (low + high) / 2;
+        if (registeredPlaceholders[mid].hash < hash)
+            low = mid + 1;
+        else if (registeredPlaceholders[mid].hash > hash)
+            high = mid;
         else
-        {
-            return "";
-        }
+            return (0 == strcmp(registeredPlaceholders[mid].name, name)) ? &registeredPlaceholders[mid] : nullptr;
     }
-    if (0 == strcmp_P(var.c_str(), PSTR("RESET_REASON")))
+    return nullptr;
+}
+
+/** Case label of a builtin placeholder, which breaks if var is a different name with the same hash. */
+#define UNIVERSALUI_PLACEHOLDER_CASE(NAME)   \
+    case placeholderHash(NAME):              \
+        if (0 != strcmp_P(var, PSTR(NAME))) \
+            break;
+
+/**
+ * Prints registered (see registerPlaceholder()) and builtin placeholders directly to out:
+ * APPNAME, __TIMESTAMP__, STATUS, STATUSBAR, RESET_REASON, SYSTIME, USERMESSAGE, PERF (if UNIVERSALUI_PROFILE is defined), HEAP (if UNIVERSALUI_HEAP_MONITOR is defined)
+ * 
+ * Unknown variables are logged as error.
+ * @return number of bytes printed
+ */
+size_t universalUiPlaceholderPrinter(const char *var, Print &out)
+{
+    const uint32_t hash = placeholderHashOf(var);
+    const PlaceholderRegistration *registration = findRegisteredPlaceholder(var, hash);
+    if (nullptr != registration)
+    {
+        if (nullptr != registration->printer)
+            return registration->printer(var, out);
+        static StaticAppendBuffer<UNIVERSALUI_PLACEHOLDER_OVERFLOW> processorBuf; // statically allocated, checked at linking time
+        return out.print(registration->processor(var, processorBuf));
+    }
+    size_t len = 0;
+    switch (hash)
     {
+    UNIVERSALUI_PLACEHOLDER_CASE("APPNAME")
+        return out.print(ui.getAppName());
+    UNIVERSALUI_PLACEHOLDER_CASE("__TIMESTAMP__")
+        return out.print(F(__TIMESTAMP__));
+    UNIVERSALUI_PLACEHOLDER_CASE("STATUS")
+        return ui.printStatusMessage(out);
+    UNIVERSALUI_PLACEHOLDER_CASE("STATUSBAR")
+        if (ui.hasStatusMessage())
+        {
+            len += out.print(F("<p style=\"color:blue;background-color:lightgrey;text-align:center;\">Status: "));
+            len += ui.printStatusMessage(out);
+            len += out.print(F("</p>"));
+        }
+        return len;
+    UNIVERSALUI_PLACEHOLDER_CASE("RESET_REASON")
 #if defined(ESP32)
         switch (rtc_get_reset_reason(0))
         {
         case 1:
-            return F("POWERON_RESET"); /**<1,  Vbat power on reset*/
+            return out.print(F("POWERON_RESET")); /**<1,  Vbat power on reset*/
         case 3:
-            return F("SW_RESET"); /**<3,  Software reset digital core*/
+            return out.print(F("SW_RESET")); /**<3,  Software reset digital core*/
         case 4:
-            return F("OWDT_RESET"); /**<4,  Legacy watch dog reset digital core*/
+            return out.print(F("OWDT_RESET")); /**<4,  Legacy watch dog reset digital core*/
         case 5:
-            return F("DEEPSLEEP_RESET"); /**<5,  Deep Sleep reset digital core*/
+            return out.print(F("DEEPSLEEP_RESET")); /**<5,  Deep Sleep reset digital core*/
         case 6:
-            return F("SDIO_RESET"); /**<6,  Reset by SLC module, reset digital core*/
+            return out.print(F("SDIO_RESET")); /**<6,  Reset by SLC module, reset digital core*/
         case 7:
-            return F("TG0WDT_SYS_RESET"); /**<7,  Timer Group0 Watch dog reset digital core*/
+            return out.print(F("TG0WDT_SYS_RESET")); /**<7,  Timer Group0 Watch dog reset digital core*/
         case 8:
-            return F("TG1WDT_SYS_RESET"); /**<8,  Timer Group1 Watch dog reset digital core*/
+            return out.print(F("TG1WDT_SYS_RESET")); /**<8,  Timer Group1 Watch dog reset digital core*/
         case 9:
-            return F("RTCWDT_SYS_RESET"); /**<9,  RTC Watch dog Reset digital core*/
+            return out.print(F("RTCWDT_SYS_RESET")); /**<9,  RTC Watch dog Reset digital core*/
         case 10:
-            return F("INTRUSION_RESET"); /**<10, Instrusion tested to reset CPU*/
+            return out.print(F("INTRUSION_RESET")); /**<10, Instrusion tested to reset CPU*/
         case 11:
-            return F("TGWDT_CPU_RESET"); /**<11, Time Group reset CPU*/
+            return out.print(F("TGWDT_CPU_RESET")); /**<11, Time Group reset CPU*/
         case 12:
-            return F("SW_CPU_RESET"); /**<12, Software reset CPU*/
+            return out.print(F("SW_CPU_RESET")); /**<12, Software reset CPU*/
         case 13:
-            return F("RTCWDT_CPU_RESET"); /**<13, RTC Watch dog Reset CPU*/
+            return out.print(F("RTCWDT_CPU_RESET")); /**<13, RTC Watch dog Reset CPU*/
         case 14:
-            return F("EXT_CPU_RESET"); /**<14, for APP CPU, reseted by PRO CPU*/
+            return out.print(F("EXT_CPU_RESET")); /**<14, for APP CPU, reseted by PRO CPU*/
         case 15:
-            return F("RTCWDT_BROWN_OUT_RESET"); /**<15, Reset when the vdd voltage is not stable*/
+            return out.print(F("RTCWDT_BROWN_OUT_RESET")); /**<15, Reset when the vdd voltage is not stable*/
         case 16:
-            return F("RTCWDT_RTC_RESET"); /**<16, RTC Watch dog reset digital core and rtc module*/
+            return out.print(F("RTCWDT_RTC_RESET")); /**<16, RTC Watch dog reset digital core and rtc module*/
         default:
-            return F("NO_MEAN");
+            return out.print(F("NO_MEAN"));
         }
 #elif defined(ESP8266)
-        return ESP.getResetReason();
+        return out.print(ESP.getResetReason());
 #else
-        return F("???");
+        return out.print(F("???"));
 #endif
-    }
-    if (0 == strcmp_P(var.c_str(), PSTR("SYSTIME")))
+    UNIVERSALUI_PLACEHOLDER_CASE("SYSTIME")
     {
-        buf.reset();
+        StaticAppendBuffer<UINT32_DIGITS + 1> ms;
+        ms.appendUInt(millis());
+        len += ms.view().printTo(out);
         if (ui.isNtpTimeValid())
         {
-            buf.printf_P(PSTR("%lu @ %s"), millis(), ui.getFormattedTime().c_str());
-            return buf.c_str();
+            char timestamp[UNIVERSALUI_TIMESTAMP_SIZE];
+            len += out.print(F(" @ "));
+            len += out.print(ui.getTimestamp(timestamp));
         }
         else
-        {
-            buf.printf_P(PSTR("%lu ms"), millis());
-            return buf.c_str();
-        }
+            len += out.print(F(" ms"));
+        return len;
     }
-    if (0 == strcmp_P(var.c_str(), PSTR("USERMESSAGE")))
-    {
+    UNIVERSALUI_PLACEHOLDER_CASE("USERMESSAGE")
         if (ui.hasUiError())
         {
-            buf.reset();
-            buf.printf_P(PSTR("<h3 style='color:red;'>%s</h3>"), &ui.getUiErrorMessage()[0]);
-            return buf.c_str();
+            len += out.print(F("<h3 style='color:red;'>"));
+            len += out.print(ui.getUiErrorMessage());
+            len += out.print(F("</h3>"));
         }
-        else
-            return "";
+        return len;
+#ifdef UNIVERSALUI_PROFILE
+    UNIVERSALUI_PLACEHOLDER_CASE("PERF")
+        return printPerfStats(out);
+#endif
+#ifdef UNIVERSALUI_HEAP_MONITOR
+    UNIVERSALUI_PLACEHOLDER_CASE("HEAP")
+        return ui.getHeapMonitor().printLatest(out);
+#endif
     }
     ui.logError() << F("DEBUG: variable not found: ") << var << endl;
-    return F("???");
+    return out.print(F("???"));
+}
+
+/**
+ * Processes registered (see registerPlaceholder()) and builtin placeholders:
+ * APPNAME, __TIMESTAMP__, STATUS, STATUSBAR, RESET_REASON, SYSTIME, USERMESSAGE, PERF (if UNIVERSALUI_PROFILE is defined), HEAP (if UNIVERSALUI_HEAP_MONITOR is defined)
+ * 
+ * Unknown variables are logged as error.
+ * Note: value is returned via buf, so it is limited to the size of buf.
+ */
+String universalUiPlaceholderProcessor(const String &var, AppendBuffer &buf)
+{
+    const PlaceholderRegistration *registration = findRegisteredPlaceholder(var.c_str(), placeholderHashOf(var.c_str()));
+    if ((nullptr != registration) && (nullptr != registration->processor))
+        return registration->processor(var, buf);
+    buf.reset();
+    universalUiPlaceholderPrinter(var.c_str(), buf);
+    return buf.c_str();
 }
 
 const String PARAM_REFRESH = "r";
@@ -157,132 +323,637 @@ public:
     }
 };
 
-static const char phPattern[] = {'$', 'L', 'O', 'G', '$'};                   // pattern to replace with content from log buffer
-static const size_t phPatternLen = sizeof(phPattern) / sizeof(phPattern[0]); // length of pattern
+const String PARAM_SINCE = "since";
+
+/**
+ * Handler for an incremental log endpoint, e.g. <code>server.on("/logtail", HTTP_GET, handleLogTail);</code>
+ * Delivers only the log content appended since the sequence number given by parameter "since", as text/plain.
+ * Response header "X-Log-Seq" holds the value of "since" for the next request.
+ * With UNIVERSALUI_ALERT_LOG_LENGTH the channels are merged, and the value is "<main>.<alert>", one sequence number per channel.
+ * Without "since" (or if it is not available anymore), the complete log is delivered, preceded by "[...] " if clipped.
+ */
+void handleLogTail(AsyncWebServerRequest *request)
+{
+    UniversalUI_LogSeq since = UniversalUI_LogSeq();
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+    if (request->hasParam(PARAM_SINCE))
+    { // one sequence number per channel: "<main>.<alert>"
+        const char *param = request->getParam(PARAM_SINCE)->value().c_str();
+        for (uint8_t i = 0; i < UNIVERSALUI_LOG_CHANNELS; ++i)
+        {
+            char *next;
+            since.seq[i] = strtoul(param, &next, 10);
+            param = ('.' == *next) ? next + 1 : next;
+        }
+    }
+#else
+    if (request->hasParam(PARAM_SINCE))
+        since = strtoul(request->getParam(PARAM_SINCE)->value().c_str(), nullptr, 10);
+#endif
+    UniversalUI_LogReadState readState;
+    readState.rawPercent = true;
+    const UniversalUI_LogSeq end = ui.beginLogRead(readState, since);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/plain", [readState](uint8_t *buf, size_t maxLen, size_t) mutable -> size_t {
+        return ui.readLog(buf, maxLen, readState);
+    });
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+    char seq[2 * UINT32_DIGITS + 2];
+    char *pos = AppendBuffer::formatUInt(seq, end.seq[UNIVERSALUI_LOG_CHANNEL_MAIN]);
+    *pos++ = '.';
+    AppendBuffer::formatUInt(pos, end.seq[UNIVERSALUI_LOG_CHANNEL_ALERT]);
+    response->addHeader("X-Log-Seq", seq);
+#else
+    response->addHeader("X-Log-Seq", String(end));
+#endif
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+
+#ifdef UNIVERSALUI_HEAP_MONITOR
+/** Handler for heap samples (see heapMonitor.h) as CSV, e.g. <code>server.on("/heap", HTTP_GET, handleHeap);</code> */
+void handleHeap(AsyncWebServerRequest *request)
+{
+    AsyncResponseStream *response = request->beginResponseStream("text/csv");
+    ui.getHeapMonitor().printCsv(*response);
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+#endif
+
+#ifdef UNIVERSALUI_PROFILE
+/**
+ * Handler for profiling data (see perfProfiler.h) as JSON, e.g. <code>server.on("/perf", HTTP_GET, handlePerf);</code>
+ * With parameter "reset", measurements are restarted after delivery.
+ */
+void handlePerf(AsyncWebServerRequest *request)
+{
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    printPerfJson(*response);
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+    if (request->hasParam("reset"))
+        resetPerfStats();
+}
+#endif
 
-class FileWithLogBufferResponseDataSource : public AwsResponseDataSource
+/**
+ * Print writing into the response buffer of the current chunk.
+ * Output not fitting is kept (up to UNIVERSALUI_PLACEHOLDER_OVERFLOW bytes) for the next chunk, more is truncated (see takeTruncated()).
+ */
+class ResponseBufferPrint : public Print
 {
 private:
-    fs::File _content;
-    size_t fileReadPosition = 0;     // how many bytes for file read
-    size_t patternFoundPosition = 0; // next location of phPattern char to match
-    size_t bufferSourceIndex = 0;    // next index from log buffer, -1 for reading from file source
-    size_t bufferRotationPoint;
+    uint8_t *_target = nullptr;
+    size_t _targetLen = 0;
+    size_t _written = 0;
+    uint8_t _overflow[UNIVERSALUI_PLACEHOLDER_OVERFLOW];
+    size_t _overflowLen = 0;
+    size_t _overflowPos = 0;
+    size_t _truncated = 0; // bytes dropped since last takeTruncated()
 
 public:
-    FileWithLogBufferResponseDataSource(fs::FS &fs, const String &path)
+    /** Starts writing into target. */
+    void begin(uint8_t *target, const size_t targetLen)
     {
-        _content = fs.open(path, "r");
+        _target = target;
+        _targetLen = targetLen;
+        _written = 0;
+    }
+    /** @return number of bytes written into target since begin() */
+    size_t written() const { return _written; }
+    bool hasOverflow() const { return _overflowPos < _overflowLen; }
+    /** @return number of bytes dropped since the last call, since they exceeded UNIVERSALUI_PLACEHOLDER_OVERFLOW */
+    size_t takeTruncated()
+    {
+        const size_t truncated = _truncated;
+        _truncated = 0;
+        return truncated;
+    }
+
+    /** Copies kept output of previous chunk into target. @return number of bytes copied */
+    size_t drain(uint8_t *target, const size_t maxLen)
+    {
+        const size_t len = ((_overflowLen - _overflowPos) < maxLen) ? (_overflowLen - _overflowPos) : maxLen;
+        memcpy(target, &_overflow[_overflowPos], len);
+        _overflowPos += len;
+        if (_overflowPos >= _overflowLen)
+            _overflowPos = _overflowLen = 0;
+        return len;
     }
 
-    virtual size_t fillBuffer(uint8_t *buf, size_t maxLen, size_t index)
+    virtual size_t write(uint8_t c)
     {
-        size_t filledLen = 0;
-        size_t targetMaxLen = maxLen;
-        uint8_t *targetBuf = buf;
-        LOGBUFFER_DEBUG("webui: start of fillBuffer with maxLen=", maxLen)
-        LOGBUFFER_DEBUGN(", index=", index)
-        if ((bufferSourceIndex > 0) || (patternFoundPosition >= phPatternLen))
-        { // we are (still) reading from the log buffer
-            size_t bufferReadLen;
-            // read data from log buffer as long more data available and space left in buf
-            do
+        return write(&c, 1);
+    }
+    virtual size_t write(const uint8_t *buf, size_t size)
+    {
+        size_t len = (hasOverflow() || _written >= _targetLen) ? 0 : _targetLen - _written;
+        if (len > size)
+            len = size;
+        memcpy(&_target[_written], buf, len);
+        _written += len;
+        size_t overflowLen = size - len;
+        if (overflowLen > (UNIVERSALUI_PLACEHOLDER_OVERFLOW - _overflowLen))
+            overflowLen = UNIVERSALUI_PLACEHOLDER_OVERFLOW - _overflowLen;
+        memcpy(&_overflow[_overflowLen], &buf[len], overflowLen);
+        _overflowLen += overflowLen;
+        _truncated += size - len - overflowLen;
+        return size;
+    }
+};
+
+struct StreamingPlaceholderRegistration
+{
+    uint32_t hash;
+    const char *name; // compared after a hit of hash
+    StreamingPlaceholderFiller filler;
+};
+static StreamingPlaceholderRegistration registeredStreamingPlaceholders[UNIVERSALUI_MAX_STREAMING_PLACEHOLDERS];
+static uint8_t registeredStreamingPlaceholderCount = 0;
+
+/** @return if name (with given hash) is "LOG" (or "ALERTLOG"), delivered by TemplateResponseDataSource itself */
+bool isBuiltinStreamingPlaceholder(const char *name, const uint32_t hash)
+{
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+    if ((placeholderHash("ALERTLOG") == hash) && (0 == strcmp_P(name, PSTR("ALERTLOG"))))
+        return true;
+#endif
+    return (placeholderHash("LOG") == hash) && (0 == strcmp_P(name, PSTR("LOG")));
+}
+
+/**
+ * Registers a streaming placeholder "$NAME$", which is delivered in chunks by TemplateResponseDataSource and FileWithLogBufferResponseDataSource.
+ * "$LOG$" is builtin and delivers the log buffer, with UNIVERSALUI_ALERT_LOG_LENGTH "$ALERTLOG$" delivers errors and warnings only.
+ * 
+ * @param name placeholder name (without '$'), consisting of letters, digits and '_'; is referenced and not copied, so it must stay valid (e.g. a string literal)
+ * @return false if UNIVERSALUI_MAX_STREAMING_PLACEHOLDERS is reached or name is already registered
+ */
+bool registerStreamingPlaceholder(const char *name, StreamingPlaceholderFiller filler)
+{
+    const uint32_t hash = placeholderHashOf(name);
+    bool registered = isBuiltinStreamingPlaceholder(name, hash);
+    for (uint8_t i = 0; i < registeredStreamingPlaceholderCount; ++i)
+        registered |= (registeredStreamingPlaceholders[i].hash == hash) && (0 == strcmp(registeredStreamingPlaceholders[i].name, name));
+    if (registered || (registeredStreamingPlaceholderCount >= UNIVERSALUI_MAX_STREAMING_PLACEHOLDERS))
+    {
+        ui.logError() << F("streaming placeholder not registered: ") << name << endl;
+        return false;
+    }
+    registeredStreamingPlaceholders[registeredStreamingPlaceholderCount++] = {hash, name, filler};
+    return true;
+}
+
+/** @return filler registered for given name and its hash, or nullptr */
+StreamingPlaceholderFiller findStreamingPlaceholder(const char *name, const uint32_t hash)
+{
+    for (uint8_t i = 0; i < registeredStreamingPlaceholderCount; ++i)
+        if ((registeredStreamingPlaceholders[i].hash == hash) && (0 == strcmp(registeredStreamingPlaceholders[i].name, name)))
+            return registeredStreamingPlaceholders[i].filler;
+    return nullptr;
+}
+
+bool isStreamingPlaceholderChar(const uint8_t c)
+{
+    return isalnum(c) || ('_' == c);
+}
+
+/** @return if name is builtin (see isBuiltinStreamingPlaceholder()) or registered with registerStreamingPlaceholder() */
+bool isStreamingPlaceholder(const char *name)
+{
+    const uint32_t hash = placeholderHashOf(name);
+    return isBuiltinStreamingPlaceholder(name, hash) || (nullptr != findStreamingPlaceholder(name, hash));
+}
+
+enum TemplateSegmentType : uint8_t
+{
+    SEGMENT_LITERAL,
+    SEGMENT_PRINTER,  // "%NAME%", including delimiters
+    SEGMENT_STREAMING // "$NAME$", including delimiters
+};
+/** Part of a cached template, its file offset is the sum of the lengths of the preceding segments. */
+struct TemplateSegment
+{
+    uint16_t length;
+    TemplateSegmentType type;
+};
+struct CachedTemplate
+{
+    String path;
+    bool printer; // if "%NAME%" placeholders are parsed
+    size_t fileSize;
+    time_t lastWrite; // of file when parsed, 0 if not supported by the filesystem
+    uint16_t firstSegment;
+    uint16_t segmentCount;
+};
+static TemplateSegment templateSegments[UNIVERSALUI_TEMPLATE_SEGMENTS];
+static uint16_t templateSegmentCount = 0;
+static CachedTemplate cachedTemplates[UNIVERSALUI_MAX_CACHED_TEMPLATES];
+static uint8_t cachedTemplateCount = 0;
+
+static bool addTemplateSegment(const TemplateSegmentType type, size_t length)
+{
+    while (length > 0)
+    {
+        if (templateSegmentCount >= UNIVERSALUI_TEMPLATE_SEGMENTS)
+            return false;
+        const uint16_t len = (length > 0xFFFF) ? 0xFFFF : length;
+        templateSegments[templateSegmentCount++] = {len, type};
+        length -= len;
+    }
+    return true;
+}
+
+/**
+ * Parses template file once into segments, so TemplateResponseDataSource (printer==true) or FileWithLogBufferResponseDataSource (printer==false)
+ * deliver it without scanning for placeholders. Call it e.g. in serverSetup(), after registerStreamingPlaceholder().
+ * If the size or modification time (getLastWrite(), if supported by the filesystem) of the file differs on delivery, it is scanned as without cache.
+ * Note: a file rewritten within the same second with the same size can't be detected, so call invalidateTemplateCache() after writing a template.
+ * 
+ * @return false if file is not found or UNIVERSALUI_MAX_CACHED_TEMPLATES or UNIVERSALUI_TEMPLATE_SEGMENTS is exceeded
+ */
+bool cacheTemplate(fs::FS &fs, const String &path, const bool printer = true)
+{
+    fs::File file = fs.open(path, "r");
+    if (!file || (cachedTemplateCount >= UNIVERSALUI_MAX_CACHED_TEMPLATES))
+    {
+        ui.logError() << F("template not cached: ") << path << endl;
+        return false;
+    }
+    const time_t lastWrite = file.getLastWrite();
+    const uint16_t firstSegment = templateSegmentCount;
+    uint8_t chunk[UNIVERSALUI_TEMPLATE_CHUNK];
+    char name[UNIVERSALUI_PLACEHOLDER_MAXLEN + 1];
+    uint8_t nameLen = 0;
+    char delimiter = '\0'; // of placeholder name being parsed
+    size_t literalLen = 0;
+    size_t fileSize = 0;
+    size_t chunkLen;
+    bool ok = true;
+    while (ok && ((chunkLen = file.read(chunk, UNIVERSALUI_TEMPLATE_CHUNK)) > 0))
+    {
+        fileSize += chunkLen;
+        for (size_t i = 0; ok && (i < chunkLen); ++i)
+        {
+            const char c = chunk[i];
+            if ('%' == delimiter)
             {
-                bufferReadLen = ui.getHtmlLog(targetBuf, targetMaxLen, bufferSourceIndex, bufferRotationPoint);
-                if (RESPONSE_TRY_AGAIN == bufferReadLen)
+                if ('%' == c)
                 {
-                    return filledLen > 0 ? filledLen : RESPONSE_TRY_AGAIN;
+                    ok = addTemplateSegment(SEGMENT_LITERAL, literalLen) && addTemplateSegment(SEGMENT_PRINTER, nameLen + 2);
+                    literalLen = 0;
+                    delimiter = '\0';
+                    continue;
                 }
-                bufferSourceIndex += bufferReadLen;
-                filledLen += bufferReadLen;
-                targetBuf += bufferReadLen;
-                targetMaxLen -= bufferReadLen;
-                LOGBUFFER_DEBUG("  webui: loaded buffer chunk ", bufferReadLen)
-                LOGBUFFER_DEBUG(", maxLen=", maxLen)
-                LOGBUFFER_DEBUGN(", targetMaxLen=", targetMaxLen)
-#ifdef VERBOSE_DEBUG_LOGBUFFER
-                Serial.print("  webui: 3>");
-                for (size_t i = 0; i < filledLen; ++i)
+                if (nameLen < UNIVERSALUI_PLACEHOLDER_MAXLEN)
                 {
-                    Serial.print((char)buf[i]);
+                    ++nameLen;
+                    continue;
                 }
-                Serial.println("<3");
+            }
+            else if ('$' == delimiter)
+            {
+                if (isStreamingPlaceholderChar(c) && (nameLen < UNIVERSALUI_PLACEHOLDER_MAXLEN))
+                {
+                    name[nameLen++] = c;
+                    continue;
+                }
+                name[nameLen] = '\0';
+                if (('$' == c) && (nameLen > 0) && isStreamingPlaceholder(name))
+                {
+                    ok = addTemplateSegment(SEGMENT_LITERAL, literalLen) && addTemplateSegment(SEGMENT_STREAMING, nameLen + 2);
+                    literalLen = 0;
+                    delimiter = '\0';
+                    continue;
+                }
+            }
+            if ('\0' != delimiter)
+            { // no placeholder, delimiter and name are literal; c is parsed again
+                literalLen += 1 + nameLen;
+                delimiter = '\0';
+            }
+            if (('$' == c) || (printer && ('%' == c)))
+            {
+                delimiter = c;
+                nameLen = 0;
+            }
+            else
+                ++literalLen;
+        }
+    }
+    file.close();
+    if ('\0' != delimiter)
+        literalLen += 1 + nameLen;
+    if (!ok || !addTemplateSegment(SEGMENT_LITERAL, literalLen))
+    {
+        templateSegmentCount = firstSegment;
+        ui.logError() << F("too many template segments, not cached: ") << path << endl;
+        return false;
+    }
+    cachedTemplates[cachedTemplateCount++] = {path, printer, fileSize, lastWrite, firstSegment, (uint16_t)(templateSegmentCount - firstSegment)};
+    return true;
+}
+
+/**
+ * Drops all templates parsed with cacheTemplate(), e.g. after a template was written. Call cacheTemplate() again to cache the new content.
+ * Note: responses being delivered still use the segments, so call it while no template is delivered, e.g. from the handler writing the template.
+ */
+void invalidateTemplateCache()
+{
+    cachedTemplateCount = 0;
+    templateSegmentCount = 0;
+}
+
+/**
+ * Delivers a template file in a single pass (no seek), replacing
+ * <li>placeholders like "%NAME%" by the output of a PlaceholderPrinter, printed directly into the response buffer, so no String is allocated.
+ * Like with AsyncWebServer, "%%" is delivered as '%'.</li>
+ * <li>streaming placeholders like "$LOG$" by the chunked content of the log buffer or of filler registered with registerStreamingPlaceholder().
+ * Unknown "$NAME$" are delivered as is.</li>
+ * 
+ * If the template was parsed with cacheTemplate(), it is delivered by its segments without scanning.
+ * 
+ * Note: use without the template processor of AsyncWebServer, since placeholders are already replaced.
+ */
+class TemplateResponseDataSource : public AwsResponseDataSource
+{
+private:
+    enum ScanState : byte
+    {
+        SCAN_LITERAL,
+        SCAN_PRINTER_NAME,   // after '%'
+        SCAN_STREAMING_NAME, // after '$'
+        SCAN_STREAMING       // delivering streaming placeholder
+    };
+    fs::File _content;
+    PlaceholderPrinter _printer;
+    ResponseBufferPrint _out;
+    uint8_t _chunk[UNIVERSALUI_TEMPLATE_CHUNK];
+    size_t _chunkLen = 0;
+    size_t _chunkPos = 0;
+    ScanState _state = SCAN_LITERAL;
+    uint8_t _nameLen = 0;
+    char _name[UNIVERSALUI_PLACEHOLDER_MAXLEN + 1];
+    StreamingPlaceholderFiller _filler = nullptr; // nullptr for "$LOG$"
+    size_t _streamIndex = 0;
+#if defined(UNIVERSALUI_ALERT_LOG_LENGTH)
+    LogMergeReadState _logReadState; // "$LOG$" merges the log channels, "$ALERTLOG$" uses the first of it
+    bool _alertLog = false;          // if "$ALERTLOG$" is delivered
+#elif defined(UNIVERSALUI_LOG_SPILL)
+    LogSpillReadState _logReadState; // "$LOG$" includes the log files
+#else
+    LogReadState _logReadState;
 #endif
-            } while (bufferReadLen > 0 && targetMaxLen > 0);
-            if (0 == bufferReadLen)
-            { // read complete log buffer, finished replacing pattern
-                bufferSourceIndex = 0;
-                patternFoundPosition = 0;
+    const TemplateSegment *_segment = nullptr; // next segment to deliver if cached, else nullptr
+    const TemplateSegment *_segmentEnd = nullptr;
+    size_t _segmentDelivered = 0; // of current literal segment
+
+    /** Delivers incomplete or unknown placeholder as is. */
+    void printName(const char delimiter)
+    {
+        _out.write(delimiter);
+        _out.write((const uint8_t *)_name, _nameLen);
+        _state = SCAN_LITERAL;
+    }
+
+    /** Prints "%NAME%" placeholder in _name, logs an error if its output was truncated. */
+    void printPlaceholder()
+    {
+        _printer(_name, _out);
+        const size_t truncated = _out.takeTruncated();
+        if (truncated > 0)
+            ui.logError() << F("output of placeholder ") << _name << F(" truncated by ") << truncated << F(" bytes, increase UNIVERSALUI_PLACEHOLDER_OVERFLOW") << endl;
+    }
+
+    /** Starts delivery of streaming placeholder in _name, if known. */
+    bool beginStreaming()
+    {
+        const uint32_t hash = placeholderHashOf(_name);
+        _filler = findStreamingPlaceholder(_name, hash);
+        if ((nullptr == _filler) && !isBuiltinStreamingPlaceholder(_name, hash))
+            return false;
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        _alertLog = (nullptr == _filler) && (placeholderHash("ALERTLOG") == hash);
+#endif
+        _streamIndex = 0;
+        _state = SCAN_STREAMING;
+        return true;
+    }
+
+    /** Delivers "$LOG$" (or "$ALERTLOG$"). */
+    size_t fillLog(uint8_t *buf, const size_t maxLen)
+    {
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        if (_alertLog)
+            return ui.getHtmlLog(UNIVERSALUI_LOG_CHANNEL_ALERT, buf, maxLen, _streamIndex, _logReadState.logs[0]);
+#endif
+        return ui.getHtmlLog(buf, maxLen, _streamIndex, _logReadState);
+    }
+
+    /** @return position of first delimiter in source, or len */
+    size_t findDelimiter(const uint8_t *source, size_t len) const
+    {
+        const uint8_t *found = (const uint8_t *)memchr(source, '$', len);
+        if (nullptr != found)
+            len = found - source;
+        if (nullptr != _printer)
+        {
+            found = (const uint8_t *)memchr(source, '%', len);
+            if (nullptr != found)
+                len = found - source;
+        }
+        return len;
+    }
+
+    /** Delivers next part of cached template. @return false at end of template */
+    bool fillFromSegment(uint8_t *buf, size_t &filled, const size_t maxLen)
+    {
+        if (_segment >= _segmentEnd)
+            return false;
+        if (SEGMENT_LITERAL == _segment->type)
+        {
+            size_t len = _segment->length - _segmentDelivered;
+            if (len > (maxLen - filled))
+                len = maxLen - filled;
+            len = _content.read(&buf[filled], len);
+            if (0 == len)
+                return false; // file was truncated
+            filled += len;
+            _segmentDelivered += len;
+            if (_segmentDelivered >= _segment->length)
+            {
+                _segmentDelivered = 0;
+                ++_segment;
             }
-            // fast exit, also avoid File.read() with a (remaining) buf size of 0
-            if (targetMaxLen <= 0)
-                return filledLen;
+            return true;
+        }
+        const size_t len = _content.read(_chunk, _segment->length);
+        if (len != _segment->length)
+            return false;
+        _nameLen = len - 2;
+        memcpy(_name, &_chunk[1], _nameLen);
+        _name[_nameLen] = '\0';
+        _out.begin(&buf[filled], maxLen - filled);
+        if (SEGMENT_PRINTER == _segment->type)
+        {
+            if (0 == _nameLen)
+                _out.write('%'); // "%%"
+            else
+                printPlaceholder();
+        }
+        else if (!beginStreaming())
+        {
+            printName('$');
+            _out.write('$');
         }
+        filled += _out.written();
+        ++_segment;
+        return true;
+    }
 
-        size_t readLen = _content.read(targetBuf, targetMaxLen);
-        if (0 == targetMaxLen && (readLen > 0))
+protected:
+    /** @param printer for "%NAME%" placeholders, or nullptr to deliver '%' as is (for AsyncWebServer's template processor) */
+    TemplateResponseDataSource(fs::FS &fs, const String &path, PlaceholderPrinter printer, const bool rawPercent) : _printer(printer)
+    {
+        _content = fs.open(path, "r");
+        _logReadState.rawPercent = rawPercent;
+#ifdef UNIVERSALUI_ALERT_LOG_LENGTH
+        _logReadState.logs[0].rawPercent = rawPercent; // for "$ALERTLOG$"
+#endif
+        for (uint8_t i = 0; i < cachedTemplateCount; ++i)
         {
-            // more potential data, but _ack() has no space
-            LOGBUFFER_DEBUGN("!! WARN: targetMaxLen=0, readLen=", readLen)
-            _content.seek(fileReadPosition);
-            return RESPONSE_TRY_AGAIN;
+            const CachedTemplate &cached = cachedTemplates[i];
+            if ((cached.printer == (nullptr != printer)) && (cached.path == path) && _content && (cached.fileSize == _content.size()) && (cached.lastWrite == _content.getLastWrite()))
+            {
+                _segment = &templateSegments[cached.firstSegment];
+                _segmentEnd = _segment + cached.segmentCount;
+                break;
+            }
         }
-        // we use *buf if AsyncWebResponse also for filtering
-        if (readLen > 0)
+    }
+
+public:
+    TemplateResponseDataSource(fs::FS &fs, const String &path, PlaceholderPrinter printer = universalUiPlaceholderPrinter) : TemplateResponseDataSource(fs, path, printer, true) {}
+
+    virtual size_t fillBuffer(uint8_t *buf, size_t maxLen, size_t)
+    {
+        if (0 == maxLen)
+            return RESPONSE_TRY_AGAIN;
+        _out.begin(buf, maxLen);
+        size_t filled = _out.drain(buf, maxLen);
+        while ((filled < maxLen) && !_out.hasOverflow())
         {
-            // search for bufferPlaceHolder
-            size_t bufSearchPosition = 0;
-            while ((bufSearchPosition < readLen) && (patternFoundPosition < phPatternLen))
+            if (SCAN_STREAMING == _state)
             {
-                if ((phPattern[patternFoundPosition] == targetBuf[bufSearchPosition++]))
-                {
-                    ++patternFoundPosition;
+                const size_t len = (nullptr == _filler) ? fillLog(&buf[filled], maxLen - filled)
+                                                        : _filler(&buf[filled], maxLen - filled, _streamIndex);
+                if (RESPONSE_TRY_AGAIN == len)
+                    return (filled > 0) ? filled : RESPONSE_TRY_AGAIN;
+                if (0 == len)
+                    _state = SCAN_LITERAL;
+                _streamIndex += len;
+                filled += len;
+                continue;
+            }
+            if (nullptr != _segment)
+            {
+                if (!fillFromSegment(buf, filled, maxLen))
+                    break;
+                continue;
+            }
+            if (_chunkPos >= _chunkLen)
+            {
+                _chunkLen = _content ? _content.read(_chunk, UNIVERSALUI_TEMPLATE_CHUNK) : 0;
+                _chunkPos = 0;
+                if (0 == _chunkLen)
+                { // end of file, deliver incomplete placeholder as is
+                    if (SCAN_LITERAL == _state)
+                        break;
+                    _out.begin(&buf[filled], maxLen - filled);
+                    printName((SCAN_PRINTER_NAME == _state) ? '%' : '$');
+                    filled += _out.written();
+                    continue;
                 }
-                else
-                    patternFoundPosition = 0;
             }
-            if ((patternFoundPosition > 0) && (bufSearchPosition >= readLen))
+            const uint8_t *source = &_chunk[_chunkPos];
+            const size_t available = _chunkLen - _chunkPos;
+            if (SCAN_LITERAL == _state)
             {
-                // special handling for possible found placeholder not completely read - introspect next possible bytes to possibly complete pattern
-                const size_t remainingPatternLen = (phPatternLen - patternFoundPosition + 1);
-                uint8_t tempBuf[remainingPatternLen];
-                const size_t tempReadLen = _content.read(tempBuf, remainingPatternLen);
-                readLen += tempReadLen;
-                // specifically search for the remaining pattern, only to know if pattern is there
-                size_t tempSearchPosition = 0;
-                while ((tempSearchPosition < remainingPatternLen) && (patternFoundPosition < phPatternLen) && (phPattern[patternFoundPosition] == tempBuf[tempSearchPosition++]))
-                    ++patternFoundPosition;
-                if (patternFoundPosition < phPatternLen)
-                { // read-ahead was not successful
-                    _content.seek(fileReadPosition - tempReadLen);
-                } // else: pattern was completely found, file position should be directly behind pattern
+                const size_t len = findDelimiter(source, (available < (maxLen - filled)) ? available : (maxLen - filled));
+                memcpy(&buf[filled], source, len);
+                filled += len;
+                _chunkPos += len;
+                if ((_chunkPos < _chunkLen) && (('$' == _chunk[_chunkPos]) || (('%' == _chunk[_chunkPos]) && (nullptr != _printer))))
+                {
+                    _state = ('%' == _chunk[_chunkPos]) ? SCAN_PRINTER_NAME : SCAN_STREAMING_NAME;
+                    ++_chunkPos;
+                    _nameLen = 0;
+                }
+                continue;
             }
-            if (patternFoundPosition >= phPatternLen)
+            const char delimiter = (SCAN_PRINTER_NAME == _state) ? '%' : '$';
+            size_t len = 0;
+            if (SCAN_PRINTER_NAME == _state)
             {
-                LOGBUFFER_DEBUGN("  webui: found pattern at pos=", bufSearchPosition)
-                // we found complete pattern
-                bufferSourceIndex = 0;
-                // next time re-read too many bytes already read from file
-                fileReadPosition = (fileReadPosition + readLen) - (readLen - bufSearchPosition); // TODO +1 , optimize expression ??
-                _content.seek(fileReadPosition);                                                 // start next file delivery directly after pattern
-                return filledLen + (bufSearchPosition - patternFoundPosition);                   // deliver the characters before the pattern
+                const uint8_t *found = (const uint8_t *)memchr(source, '%', available);
+                len = (nullptr != found) ? (found - source) : available;
             }
             else
-                return filledLen + readLen; // found no pattern, deliver complete chunk
-        }
-        else
-        {
-            // reached end of file
-            LOGBUFFER_DEBUGN("end-of-file at deliveredBytes=", index)
-            return 0;
+                while ((len < available) && isStreamingPlaceholderChar(source[len]))
+                    ++len;
+            _out.begin(&buf[filled], maxLen - filled);
+            if ((_nameLen + len) > UNIVERSALUI_PLACEHOLDER_MAXLEN)
+            { // too long for a placeholder name, is delivered as literal after its first UNIVERSALUI_PLACEHOLDER_MAXLEN characters
+                const size_t nameLen = UNIVERSALUI_PLACEHOLDER_MAXLEN - _nameLen;
+                memcpy(&_name[_nameLen], source, nameLen);
+                _nameLen += nameLen;
+                _chunkPos += nameLen;
+                printName(delimiter);
+            }
+            else
+            {
+                memcpy(&_name[_nameLen], source, len);
+                _nameLen += len;
+                _chunkPos += len;
+                if (_chunkPos < _chunkLen)
+                {
+                    _name[_nameLen] = '\0';
+                    if (delimiter != _chunk[_chunkPos])
+                        printName(delimiter); // invalid character, is delivered as literal
+                    else if (SCAN_PRINTER_NAME == _state)
+                    {
+                        ++_chunkPos;
+                        _state = SCAN_LITERAL;
+                        if (0 == _nameLen)
+                            _out.write('%'); // "%%"
+                        else
+                            printPlaceholder();
+                    }
+                    else if ((_nameLen > 0) && beginStreaming())
+                        ++_chunkPos;
+                    else
+                        printName(delimiter); // closing '$' may start next placeholder
+                }
+            }
+            filled += _out.written();
         }
+        return filled;
     }
 
-    virtual ~FileWithLogBufferResponseDataSource()
+    virtual ~TemplateResponseDataSource()
     {
         if (_content)
             _content.close();
     }
 };
 
+/**
+ * Delivers a file, replacing streaming placeholders like "$LOG$" (see TemplateResponseDataSource).
+ * Other placeholders are left to the template processor of AsyncWebServer, so '%' in the log is encoded as "%%".
+ */
+class FileWithLogBufferResponseDataSource : public TemplateResponseDataSource
+{
+public:
+    FileWithLogBufferResponseDataSource(fs::FS &fs, const String &path) : TemplateResponseDataSource(fs, path, nullptr, false) {}
+};
+
 #endif